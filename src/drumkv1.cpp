@@ -38,9 +38,12 @@
 #include "drumkv1_controls.h"
 #include "drumkv1_programs.h"
 #include "drumkv1_tuning.h"
+#include "drumkv1_kit.h"
 
 #include "drumkv1_sched.h"
 
+#include "drumkv1_mlock.h"
+
 
 #ifdef CONFIG_DEBUG_0
 #include <cstdio>
@@ -48,6 +51,8 @@
 
 #include <cstring>
 
+#include <QMutex>
+
 
 //-------------------------------------------------------------------------
 // drumkv1_impl
@@ -63,6 +68,8 @@ const uint8_t MAX_GROUP   = 128;
 const float MIN_ENV_MSECS = 0.5f;		// min 500 usec per stage
 const float MAX_ENV_MSECS = 2000.0f;	// max 2 sec per stage (default)
 
+const float XFADE_MSECS   = 20.0f;		// kit swap voice fade-out
+
 const float COARSE_SCALE  = 12.0f;
 const float FINE_SCALE    = 1.0f;
 const float SWEEP_SCALE   = 0.5f;
@@ -476,7 +483,7 @@ public:
 	drumkv1_port  fine;
 	drumkv1_port  envtime;
 
-	float sample0, envtime0;
+	float sample0, envtime0, coarse0;
 
 protected:
 
@@ -570,6 +577,17 @@ protected:
 			element->setReverse(reverse.value() > 0.5f);
 			element->sampleReverseSync();
 			break;
+		case drumkv1::GEN1_COARSE: {
+			// Build requested octave levels...
+			drumkv1_sample *sample = element->sample();
+			if (sample)
+				sample->updateLevels();
+			return;
+		}
+		case drumkv1::LFO1_SHAPE:
+			// Build own LFO wave table...
+			element->updateLfoWave();
+			return;
 		default:
 			break;
 		}
@@ -815,7 +833,8 @@ class drumkv1_elem : public drumkv1_list<drumkv1_elem>
 {
 public:
 
-	drumkv1_elem(drumkv1 *pDrumk, float srate, int key);
+	drumkv1_elem(drumkv1 *pDrumk, float srate, int key,
+		drumkv1_wave_lf *pLfo1Wave0, drumkv1_formant::Impl *pDcf1Formant);
 
 	~drumkv1_elem();
 
@@ -826,9 +845,21 @@ public:
 
 	drumkv1_sample_ref gen1_sample;
 
-	drumkv1_wave_lf lfo1_wave;
+	// shared default and own (lazily built) LFO wave tables.
+	drumkv1_wave_lf *lfo1_wave0;
+	std::atomic<drumkv1_wave_lf *> lfo1_wave;
+	std::atomic<bool> lfo1_wave_req;
+
+	drumkv1_wave_lf *lfo1_wave_ref() const
+	{
+		drumkv1_wave_lf *wave = lfo1_wave.load(std::memory_order_acquire);
+		return (wave ? wave : lfo1_wave0);
+	}
+
+	void lfo1_wave_test(drumkv1_wave::Shape shape, float width);
 
-	drumkv1_formant::Impl dcf1_formant;
+	// shared formant scratch (per instance).
+	drumkv1_formant::Impl *dcf1_formant;
 
 	drumkv1_gen    gen1;
 	drumkv1_dcf    dcf1;
@@ -843,13 +874,16 @@ public:
 	float params[3][drumkv1::NUM_ELEMENT_PARAMS];
 
 	void updateEnvTimes(float srate);
+	void updateLfoWave();
 };
 
 
 // synth element
 
-drumkv1_elem::drumkv1_elem ( drumkv1 *pDrumk, float srate, int key )
-	: element(this), gen1(pDrumk, key)
+drumkv1_elem::drumkv1_elem ( drumkv1 *pDrumk, float srate, int key,
+	drumkv1_wave_lf *pLfo1Wave0, drumkv1_formant::Impl *pDcf1Formant )
+	: element(this), lfo1_wave0(pLfo1Wave0), lfo1_wave(nullptr),
+		lfo1_wave_req(false), dcf1_formant(pDcf1Formant), gen1(pDrumk, key)
 {
 	// inittialize elemet sample list.
 	gen1_sample.append(new drumkv1_sample(srate));
@@ -868,24 +902,53 @@ drumkv1_elem::drumkv1_elem ( drumkv1 *pDrumk, float srate, int key )
 	// max env. stage length (default)
 	gen1.envtime0 = 0.0001f * MAX_ENV_MSECS;
 
+	// default tuning (octave levels)
+	gen1.coarse0 = 0.0f;
+
 	for (int j = 0; j < 3; ++j) {
 		params[j][drumkv1::GEN1_SAMPLE]  = gen1.sample0;
 		params[j][drumkv1::GEN1_ENVTIME] = gen1.envtime0;
 	}
 
 	// element sample rate
-	gen1_sample.next()->setSampleRate(srate);
-	lfo1_wave.setSampleRate(srate);
+	gen1_sample.current()->setSampleRate(srate);
 
 	updateEnvTimes(srate);
-
-	dcf1_formant.setSampleRate(srate);
 }
 
 
 drumkv1_elem::~drumkv1_elem (void)
 {
 	gen1_sample.clear_refs(true);
+
+	delete lfo1_wave.load();
+}
+
+
+// test whether the LFO wave table needs to change (RT safe):
+// the shared default table serves until a different shape/width
+// is asked for, then an own table gets built off the RT thread.
+void drumkv1_elem::lfo1_wave_test ( drumkv1_wave::Shape shape, float width )
+{
+	drumkv1_wave_lf *wave = lfo1_wave.load(std::memory_order_acquire);
+	if (wave)
+		wave->reset_test(shape, width);
+	else
+	if ((shape != lfo1_wave0->shape() || width != lfo1_wave0->width())
+		&& !lfo1_wave_req.exchange(true))
+		gen1.schedule(drumkv1::LFO1_SHAPE);
+}
+
+
+// build own LFO wave table (non-RT, worker thread).
+void drumkv1_elem::updateLfoWave (void)
+{
+	if (lfo1_wave.load() == nullptr) {
+		drumkv1_wave_lf *wave = new drumkv1_wave_lf();
+		wave->setSampleRate(lfo1_wave0->sampleRate());
+		wave->reset(drumkv1_wave::Shape(*lfo1.shape), *lfo1.width);
+		lfo1_wave.store(wave, std::memory_order_release);
+	}
 }
 
 
@@ -896,7 +959,7 @@ void drumkv1_elem::updateEnvTimes ( float srate )
 
 	float envtime_msecs = 10000.0f * gen1.envtime0;
 	if (envtime_msecs < MIN_ENV_MSECS) {
-		drumkv1_sample *sample = gen1_sample.next();
+		drumkv1_sample *sample = gen1_sample.current();
 		const uint32_t envtime_frames
 			= (sample->offsetEnd() - sample->offsetStart()) >> 1;
 		envtime_msecs = envtime_frames / srate_ms;
@@ -924,22 +987,32 @@ void drumkv1_elem::updateEnvTimes ( float srate )
 
 // voice
 
+struct drumkv1_elem_set;
+
 struct drumkv1_voice : public drumkv1_list<drumkv1_voice>
 {
 	drumkv1_voice(drumkv1_elem *pElem = nullptr);
 
-	void reset(drumkv1_elem *pElem)
+	void reset(drumkv1_elem *pElem,
+		drumkv1_sample_ref::sample_ref *pRef = nullptr)
 	{
 		elem = pElem;
+		elem_set = nullptr;
+
+		xfade_frames = 0;
+		xfade_gain = 1.0f;
+		xfade_delta = 0.0f;
 
-		gen1.reset(pElem ? pElem->gen1_sample.next() : nullptr);
-		lfo1.reset(pElem ? &pElem->lfo1_wave : nullptr);
+		gen1_ref = pRef;
+		gen1.reset(pRef ? pRef->refp : nullptr);
+		lfo1.reset(pElem ? pElem->lfo1_wave_ref() : nullptr);
 
-		dcf17.reset(pElem ? &pElem->dcf1_formant : nullptr);
-		dcf18.reset(pElem ? &pElem->dcf1_formant : nullptr);
+		dcf17.reset(pElem ? pElem->dcf1_formant : nullptr);
+		dcf18.reset(pElem ? pElem->dcf1_formant : nullptr);
 	}
 
 	drumkv1_elem *elem;
+	drumkv1_elem_set *elem_set;					// old element set, if swapped
 
 	int note;									// voice note
 	int group;									// voice group
@@ -947,6 +1020,8 @@ struct drumkv1_voice : public drumkv1_list<drumkv1_voice>
 	float vel;									// key velocity
 	float pre;									// key pressure/after-touch
 
+	drumkv1_sample_ref::sample_ref *gen1_ref;	// acquired sample reference
+
 	drumkv1_generator  gen1;
 	drumkv1_oscillator lfo1;
 
@@ -971,10 +1046,46 @@ struct drumkv1_voice : public drumkv1_list<drumkv1_voice>
 	drumkv1_bal1  out1_pan;						// output panning
 	drumkv1_ramp1 out1_vol;						// output volume
 
+	uint32_t xfade_frames;						// kit swap fade-out
+	float xfade_gain;
+	float xfade_delta;
+
 	bool sustain;
 };
 
 
+// element set (kit), swapped in as a whole
+
+struct drumkv1_elem_set : public drumkv1_list<drumkv1_elem_set>
+{
+	drumkv1_elem_set() : nvoices(0), retired(false), xfade(false), key0(-1), serial(0)
+	{
+		for (int note = 0; note < MAX_NOTES; ++note)
+			elems[note] = nullptr;
+	}
+
+	~drumkv1_elem_set()
+	{
+		drumkv1_elem *elem = list.next();
+		while (elem) {
+			list.remove(elem);
+			delete elem;
+			elem = list.next();
+		}
+	}
+
+	drumkv1_elem *elems[MAX_NOTES];
+
+	drumkv1_list<drumkv1_elem> list;
+
+	std::atomic<int> nvoices;					// old voices still playing
+	std::atomic<bool> retired;					// swapped out or superseded
+	bool xfade;									// fade them out on swap
+	int  key0;									// current element after swap
+	uint32_t serial;							// update order (non-RT)
+};
+
+
 // MIDI input asynchronous status notification
 
 class drumkv1_midi_in : public drumkv1_sched
@@ -1009,6 +1120,43 @@ private:
 };
 
 
+// background sample re-resampling (on sample-rate change)
+
+class drumkv1_impl;
+
+class drumkv1_resample_sched : public drumkv1_sched
+{
+public:
+
+	drumkv1_resample_sched (drumkv1 *pDrumk, drumkv1_impl *pImpl)
+		: drumkv1_sched(pDrumk, Resample, MAX_NOTES + 1),
+			m_pImpl(pImpl) {}
+
+	void process(int key);
+
+private:
+
+	drumkv1_impl *m_pImpl;
+};
+
+
+// deferred old element sets (and retired samples) reclamation.
+
+class drumkv1_reclaim_sched : public drumkv1_sched
+{
+public:
+
+	drumkv1_reclaim_sched (drumkv1 *pDrumk, drumkv1_impl *pImpl)
+		: drumkv1_sched(pDrumk, Reclaim), m_pImpl(pImpl) {}
+
+	void process(int);
+
+private:
+
+	drumkv1_impl *m_pImpl;
+};
+
+
 // micro-tuning/instance implementation
 
 class drumkv1_tun
@@ -1041,6 +1189,10 @@ public:
 	void setSampleRate(float srate);
 	float sampleRate() const;
 
+	void resampleElements();
+	void resampleElement(int key);
+	float resampleProgress() const;
+
 	void setBufferSize(uint32_t nsize);
 	uint32_t bufferSize() const;
 
@@ -1057,6 +1209,11 @@ public:
 	void resetElements();
 	void clearElements();
 
+	void applyKit(const drumkv1_kit *pKit, bool bXfade);
+	void updateElements(const drumkv1_kit *pKit, bool bXfade = false);
+
+	void reclaimElements();
+
 	void setSampleFile(const char *pszSampleFile);
 	const char *sampleFile() const;
 
@@ -1072,6 +1229,12 @@ public:
 	uint32_t offsetStart() const;
 	uint32_t offsetEnd() const;
 
+	void setSampleFormat(int iSampleFormat);
+	int sampleFormat() const;
+
+	void setResampleQuality(int iResampleQuality);
+	int resampleQuality() const;
+
 	void setTempo(float bpm);
 	float tempo() const;
 
@@ -1084,6 +1247,8 @@ public:
 	drumkv1_controls *controls();
 	drumkv1_programs *programs();
 
+	drumkv1_sched_notifiers *notifiers();
+
 	void setTuningEnabled(bool enabled);
 	bool isTuningEnabled() const;
 
@@ -1145,8 +1310,7 @@ protected:
 		if (elem) {
 			pv = m_free_list.next();
 			if (pv) {
-				elem->gen1_sample.acquire();
-				pv->reset(elem);
+				pv->reset(elem, elem->gen1_sample.acquire());
 				m_free_list.remove(pv);
 				m_play_list.append(pv);
 				++m_nvoices;
@@ -1157,9 +1321,15 @@ protected:
 
 	void free_voice ( drumkv1_voice *pv )
 	{
+		bool bReclaim = false;
 		drumkv1_elem *elem = pv->elem;
 		if (elem)
-			elem->gen1_sample.release();
+			bReclaim = elem->gen1_sample.release(pv->gen1_ref);
+		drumkv1_elem_set *set = pv->elem_set;
+		if (set && set->nvoices.fetch_sub(1, std::memory_order_release) == 1)
+			bReclaim = true;
+		if (bReclaim)
+			m_reclaim.schedule();
 		m_play_list.remove(pv);
 		m_free_list.append(pv);
 		pv->reset(nullptr);
@@ -1167,21 +1337,49 @@ protected:
 	}
 
 	void alloc_sfxs(uint32_t nsize);
+	void alloc_caches();
+
+	void load_elem(drumkv1_elem *elem, const drumkv1_kit::Element *pElement,
+		drumkv1_sample *sample0, int iLoadQuality);
+
+	drumkv1_elem_set *load_elem_set(const drumkv1_kit *pKit, bool bXfade);
+	bool post_elem_set(drumkv1_elem_set *set);
+	void resample_elems();
+
+	void swap_elem_set(drumkv1_elem_set *set);
+	void swapped_elem_set();
+	void take_elem_sets(drumkv1_list<drumkv1_elem_set>& sets, bool bForce = false);
+	void free_elem_sets(drumkv1_list<drumkv1_elem_set>& sets);
 
 private:
 
 	drumkv1 *m_pDrumk;
 
+	drumkv1_sched_notifiers m_notifiers;
+
 	drumkv1_config   m_config;
 	drumkv1_controls m_controls;
 	drumkv1_programs m_programs;
 	drumkv1_midi_in  m_midi_in;
 	drumkv1_tun      m_tun;
 
+	drumkv1_resample_sched m_resample;
+	drumkv1_reclaim_sched  m_reclaim;
+
+	std::atomic<uint32_t> m_resample_total;
+	std::atomic<uint32_t> m_resample_done;
+	std::atomic<bool>     m_resample_keys[MAX_NOTES];
+
 	uint16_t m_nchannels;
 	float    m_srate;
 	float    m_bpm;
 
+	int      m_sample_format;
+	int      m_resample_quality;
+
+	drumkv1_wave_lf m_lfo1_wave;
+	drumkv1_formant::Impl m_dcf1_formant;
+
 	float    m_freqs[MAX_NOTES];
 
 	drumkv1_ctl m_ctl;
@@ -1214,9 +1412,28 @@ private:
 
 	drumkv1_list<drumkv1_elem>  m_elem_list;
 
+	// pending (next) and retired (old) element sets.
+	std::atomic<drumkv1_elem_set *> m_elem_set;
+
+	drumkv1_list<drumkv1_elem_set> m_elem_sets;
+	QMutex m_elem_sets_mutex;
+
+	// serializes element set updates (non-RT); never held while
+	// loading samples nor while deleting elements (scheds).
+	QMutex m_update_mutex;
+
+	uint32_t m_update_serial;
+	uint32_t m_update_last;
+
+	// last swap yet to be followed up (non-RT).
+	std::atomic<bool> m_swapped;
+	std::atomic<int>  m_swap_key0;
+
 	float  **m_sfxs;
 	uint32_t m_nsize;
 
+	float   *m_caches;
+
 	drumkv1_fx_chorus   m_chorus;
 	drumkv1_fx_flanger *m_flanger;
 	drumkv1_fx_phaser  *m_phaser;
@@ -1260,7 +1477,11 @@ drumkv1_voice::drumkv1_voice ( drumkv1_elem *pElem ) :
 drumkv1_impl::drumkv1_impl (
 	drumkv1 *pDrumk, uint16_t nchannels, float srate, uint32_t nsize )
 	: m_pDrumk(pDrumk),	m_controls(pDrumk), m_programs(pDrumk),
-		m_midi_in(pDrumk), m_bpm(180.0f), m_nvoices(0), m_running(false)
+		m_midi_in(pDrumk), m_resample(pDrumk, this), m_reclaim(pDrumk, this),
+		m_resample_total(0), m_resample_done(0),
+		m_bpm(180.0f), m_elem_set(nullptr), m_update_serial(0), m_update_last(0),
+		m_swapped(false), m_swap_key0(-1),
+		m_nvoices(0), m_running(false)
 {
 	// allocate voice pool.
 	m_voices = new drumkv1_voice * [MAX_VOICES];
@@ -1270,8 +1491,10 @@ drumkv1_impl::drumkv1_impl (
 		m_free_list.append(m_voices[i]);
 	}
 
-	for (int note = 0; note < MAX_NOTES; ++note)
+	for (int note = 0; note < MAX_NOTES; ++note) {
 		m_notes[note] = nullptr;
+		m_resample_keys[note].store(false);
+	}
 
 	for (int group = 0; group < MAX_GROUP; ++group)
 		m_group[group] = nullptr;
@@ -1283,10 +1506,27 @@ drumkv1_impl::drumkv1_impl (
 	// special case for sample element switching
 	m_key = new drumkv1_port();
 
+	// default sample storage format
+	m_sample_format = m_config.iSampleFormat;
+
+	// default resampler quality profile
+	m_resample_quality = m_config.iResampleQuality;
+
+	// sample silence trimming threshold
+	drumkv1_sample::setSilenceThreshold(m_config.bSilenceTrim
+		? ::powf(10.0f, 0.05f * m_config.fSilenceThreshold) : 0.0f);
+
+	// prefault and lock sample, table and delay-line memory
+	drumkv1_mlock::setEnabled(m_config.bMemoryLock, m_config.bHugePages);
+
 	// local buffers none yet
 	m_sfxs = nullptr;
 	m_nsize = 0;
 
+	// compressed block-decode caches, if so
+	m_caches = nullptr;
+	alloc_caches();
+
 	// flangers none yet
 	m_flanger = nullptr;
 
@@ -1299,6 +1539,11 @@ drumkv1_impl::drumkv1_impl (
 	// compressors none yet
 	m_comp = nullptr;
 
+	// shared default LFO wave (as per default shape and width)
+	m_lfo1_wave.reset(
+		drumkv1_wave::Shape(drumkv1_param::paramDefaultValue(drumkv1::LFO1_SHAPE)),
+		drumkv1_param::paramDefaultValue(drumkv1::LFO1_WIDTH));
+
 	// Micro-tuning support, if any...
 	resetTuning();
 
@@ -1348,14 +1593,31 @@ drumkv1_impl::~drumkv1_impl (void)
 
 	delete [] m_voices;
 
+	// deallocate compressed block-decode caches
+	if (m_caches) {
+		drumkv1_mlock::unlock(m_caches);
+		delete [] m_caches;
+		m_caches = nullptr;
+	}
+
 	// deallocate local buffers
 	alloc_sfxs(0);
 
 	// deallocate channels
 	setChannels(0);
 
+	// chorus delay lines
+	drumkv1_mlock::unlock(&m_chorus);
+
 	// deallocate elements
 	clearElements();
+
+	// deallocate pending and old element sets
+	m_elem_set.store(nullptr);
+
+	drumkv1_list<drumkv1_elem_set> sets;
+	take_elem_sets(sets, true);
+	free_elem_sets(sets);
 }
 
 
@@ -1365,6 +1627,7 @@ void drumkv1_impl::setChannels ( uint16_t nchannels )
 
 	// deallocate flangers
 	if (m_flanger) {
+		drumkv1_mlock::unlock(m_flanger);
 		delete [] m_flanger;
 		m_flanger = nullptr;
 	}
@@ -1377,6 +1640,7 @@ void drumkv1_impl::setChannels ( uint16_t nchannels )
 
 	// deallocate delays
 	if (m_delay) {
+		drumkv1_mlock::unlock(m_delay);
 		delete [] m_delay;
 		m_delay = nullptr;
 	}
@@ -1399,6 +1663,13 @@ void drumkv1_impl::setSampleRate ( float srate )
 {
 	// set internal sample rate
 	m_srate = srate;
+
+	// shared default LFO wave and formant scratch
+	m_lfo1_wave.setSampleRate(srate);
+	m_dcf1_formant.setSampleRate(srate);
+
+	// re-resample all loaded samples, in the background
+	resampleElements();
 }
 
 
@@ -1408,6 +1679,117 @@ float drumkv1_impl::sampleRate (void) const
 }
 
 
+// whether a loaded sample needs re-resampling (rate or quality).
+static bool resample_test (
+	drumkv1_sample *sample, float srate, drumkv1_sample::Quality quality )
+{
+	if (sample->filename() == nullptr)
+		return false;
+	if (sample->sampleRate() != srate)
+		return true;
+	return (sample->quality() != quality && sample->sourceRate() != srate);
+}
+
+
+// schedule background re-resampling of all loaded elements;
+// deferred while a new element set is pending (non-RT).
+void drumkv1_impl::resampleElements (void)
+{
+	m_update_mutex.lock();
+
+	if (m_elem_set.load(std::memory_order_acquire) == nullptr)
+		resample_elems();
+
+	m_update_mutex.unlock();
+}
+
+
+void drumkv1_impl::resample_elems (void)
+{
+	const drumkv1_sample::Quality quality
+		= drumkv1_sample::Quality(m_resample_quality);
+
+	drumkv1_elem *elem = m_elem_list.next();
+	while (elem) {
+		drumkv1_sample *sample = elem->gen1_sample.current();
+		if (resample_test(sample, m_srate, quality)) {
+			// count each key once, as pending schedules coalesce...
+			const int key = int(elem->gen1.sample0);
+			if (!m_resample_keys[key].exchange(true))
+				m_resample_total.fetch_add(1);
+			m_resample.schedule(key);
+		}
+		elem = elem->next();
+	}
+}
+
+
+// re-resample one element sample from its source data, committing
+// it atomically as the new current sample (non-RT, worker thread).
+void drumkv1_impl::resampleElement ( int key )
+{
+	if (key < 0 || key >= MAX_NOTES)
+		return;
+
+	// counted in only once, even if re-scheduled meanwhile...
+	const bool bCounted = m_resample_keys[key].exchange(false);
+
+	drumkv1_elem *elem = m_elems[key];
+	if (elem) {
+		const float srate = m_srate;
+		const drumkv1_sample::Quality quality
+			= drumkv1_sample::Quality(m_resample_quality);
+		drumkv1_sample *prev = elem->gen1_sample.current();
+		if (resample_test(prev, srate, quality)) {
+			drumkv1_sample *next = new drumkv1_sample(*prev);
+			next->setSampleRate(srate);
+			next->setQuality(quality);
+			// unless failed or replaced meanwhile...
+			if (next->resample(prev)
+				&& elem->gen1_sample.current() == prev) {
+				elem->gen1_sample.append(next);
+				drumkv1_wave_lf *wave = elem->lfo1_wave.load();
+				if (wave)
+					wave->setSampleRate(srate);
+				elem->updateEnvTimes(srate);
+			}
+			else delete next;
+		}
+	}
+
+	if (!bCounted)
+		return;
+
+	// all done? reset, but keep whatever got counted meanwhile...
+	const uint32_t ndone = m_resample_done.fetch_add(1) + 1;
+	uint32_t ntotal = ndone;
+	if (m_resample_total.compare_exchange_strong(ntotal, 0))
+		m_resample_done.fetch_sub(ndone);
+}
+
+
+float drumkv1_impl::resampleProgress (void) const
+{
+	const uint32_t ntotal = m_resample_total.load();
+	const uint32_t ndone  = m_resample_done.load();
+	return (ntotal > 0 && ndone < ntotal ? float(ndone) / float(ntotal) : 1.0f);
+}
+
+
+// background re-resampling processor.
+void drumkv1_resample_sched::process ( int key )
+{
+	m_pImpl->resampleElement(key);
+}
+
+
+// deferred old element sets (and retired samples) reclamation processor.
+void drumkv1_reclaim_sched::process ( int )
+{
+	m_pImpl->reclaimElements();
+}
+
+
 void drumkv1_impl::setBufferSize ( uint32_t nsize )
 {
 	// set nominal buffer size
@@ -1421,6 +1803,36 @@ uint32_t drumkv1_impl::bufferSize (void) const
 }
 
 
+void drumkv1_impl::setSampleFormat ( int iSampleFormat )
+{
+	// sample storage format (next loaded samples)
+	m_sample_format = iSampleFormat;
+
+	alloc_caches();
+}
+
+
+int drumkv1_impl::sampleFormat (void) const
+{
+	return m_sample_format;
+}
+
+
+void drumkv1_impl::setResampleQuality ( int iResampleQuality )
+{
+	// resampler quality profile (upgrades in the background)
+	m_resample_quality = iResampleQuality;
+
+	resampleElements();
+}
+
+
+int drumkv1_impl::resampleQuality (void) const
+{
+	return m_resample_quality;
+}
+
+
 void drumkv1_impl::setTempo ( float bpm )
 {
 	// set nominal tempo (BPM)
@@ -1454,13 +1866,33 @@ void drumkv1_impl::alloc_sfxs ( uint32_t nsize )
 }
 
 
+// compressed sample block-decode caches, one per voice, allocated
+// only as soon as that's the storage format, and kept for good, as
+// voices may still be playing on those (non-RT).
+void drumkv1_impl::alloc_caches (void)
+{
+	if (m_caches || m_sample_format != int(drumkv1_sample::Compressed))
+		return;
+
+	const uint32_t nsize = drumkv1_generator::CACHE_SIZE;
+	float *caches = new float [MAX_VOICES * nsize];
+	drumkv1_mlock::lock(caches, MAX_VOICES * nsize * sizeof(float));
+
+	for (int i = 0; i < MAX_VOICES; ++i)
+		m_voices[i]->gen1.setCache(caches + i * nsize);
+
+	m_caches = caches;
+}
+
+
 drumkv1_element *drumkv1_impl::addElement ( int key )
 {
 	drumkv1_elem *elem = nullptr;
 	if (key >= 0 && key < MAX_NOTES) {
 		elem = m_elems[key];
 		if (elem == nullptr) {
-			elem = new drumkv1_elem(m_pDrumk, m_srate, key);
+			elem = new drumkv1_elem(m_pDrumk, m_srate, key,
+				&m_lfo1_wave, &m_dcf1_formant);
 			m_elem_list.append(elem);
 			m_elems[key] = elem;
 		}
@@ -1597,6 +2029,362 @@ void drumkv1_impl::clearElements (void)
 		delete elem;
 		elem = m_elem_list.next();
 	}
+
+	// reclaim old element sets, if done
+	drumkv1_list<drumkv1_elem_set> sets;
+	m_update_mutex.lock();
+	take_elem_sets(sets);
+	m_update_mutex.unlock();
+	free_elem_sets(sets);
+}
+
+
+// apply a pre-decoded kit: build a whole new element set off the
+// RT thread, then have it swapped in at a block boundary (non-RT).
+void drumkv1_impl::applyKit ( const drumkv1_kit *pKit, bool bXfade )
+{
+	m_update_mutex.lock();
+
+	// per kit sample storage format and resampler quality
+	const int iSampleFormat = pKit->sampleFormat();
+	m_sample_format = (iSampleFormat >= 0
+		? iSampleFormat : m_config.iSampleFormat);
+	const int iResampleQuality = pKit->resampleQuality();
+	m_resample_quality = (iResampleQuality >= 0
+		? iResampleQuality : m_config.iResampleQuality);
+
+	alloc_caches();
+
+	m_update_mutex.unlock();
+
+	// new element set, current element as of the kit
+	drumkv1_elem_set *set = load_elem_set(pKit, bXfade);
+	set->key0 = pKit->currentElement();
+
+	m_update_mutex.lock();
+
+	const bool bPosted = post_elem_set(set);
+	if (bPosted) {
+		// global params and micro-tuning
+		for (uint32_t i = 0; i < drumkv1::NUM_PARAMS; ++i) {
+			const drumkv1::ParamIndex index = drumkv1::ParamIndex(i);
+			if (pKit->isParamValue(index))
+				setParamValue(index, pKit->paramValue(index));
+		}
+		const drumkv1_kit::Tuning& tuning = pKit->tuning();
+		if (tuning.valid || m_tun.enabled) {
+			m_pDrumk->setTuningEnabled(tuning.valid && tuning.enabled);
+			if (tuning.valid) {
+				m_pDrumk->setTuningRefPitch(tuning.refPitch);
+				m_pDrumk->setTuningRefNote(tuning.refNote);
+				m_pDrumk->setTuningScaleFile(tuning.scaleFile.constData());
+				m_pDrumk->setTuningKeyMapFile(tuning.keyMapFile.constData());
+			}
+			m_pDrumk->updateTuning();
+		}
+		stabilize();
+	}
+
+	m_update_mutex.unlock();
+
+	// superseded meanwhile, never handed over
+	if (!bPosted)
+		delete set;
+}
+
+
+// build a whole new element set from the kit elements, as a diff
+// against the current ones, then have it swapped in (non-RT).
+void drumkv1_impl::updateElements ( const drumkv1_kit *pKit, bool bXfade )
+{
+	drumkv1_elem_set *set = load_elem_set(pKit, bXfade);
+
+	m_update_mutex.lock();
+
+	// current element as is
+	set->key0 = m_key0;
+
+	const bool bPosted = post_elem_set(set);
+
+	m_update_mutex.unlock();
+
+	// superseded meanwhile, never handed over
+	if (!bPosted)
+		delete set;
+}
+
+
+// build a new element set, loading samples out of the update
+// lock; only the current elements on the same keys are looked
+// up while locked, for their samples (shared) and param values
+// (a diff against), as of now (non-RT).
+drumkv1_elem_set *drumkv1_impl::load_elem_set (
+	const drumkv1_kit *pKit, bool bXfade )
+{
+	drumkv1_elem_set *set = new drumkv1_elem_set();
+	set->xfade = bXfade;
+
+	const drumkv1_kit::Element *elements[MAX_NOTES];
+	drumkv1_sample *samples[MAX_NOTES];
+	for (int note = 0; note < MAX_NOTES; ++note) {
+		elements[note] = nullptr;
+		samples[note] = nullptr;
+	}
+
+	m_update_mutex.lock();
+
+	set->serial = ++m_update_serial;
+
+	// samples loaded anew, possibly as draft first;
+	// upgraded in the background, as swapped in...
+	int iLoadQuality = pKit->loadQuality();
+	if (iLoadQuality < 0)
+		iLoadQuality = m_resample_quality;
+
+	QListIterator<drumkv1_kit::Element *> iter(pKit->elements());
+	while (iter.hasNext()) {
+		const drumkv1_kit::Element *pElement = iter.next();
+		const int key = pElement->key;
+		if (key < 0 || key >= MAX_NOTES || elements[key])
+			continue;
+		elements[key] = pElement;
+		drumkv1_elem *elem = new drumkv1_elem(m_pDrumk, m_srate, key,
+			&m_lfo1_wave, &m_dcf1_formant);
+		drumkv1_elem *elem0 = m_elems[key];
+		if (elem0) {
+			// param values, live ones if current...
+			::memcpy(elem->params, elem0->params, sizeof(elem->params));
+			if (elem0 == m_elem) {
+				for (uint32_t i = 0; i < drumkv1::NUM_ELEMENT_PARAMS; ++i) {
+					const drumkv1::ParamIndex index = drumkv1::ParamIndex(i);
+					if (index == drumkv1::GEN1_SAMPLE)
+						continue;
+					drumkv1_port *pParamPort = elem0->element.paramPort(index);
+					if (pParamPort)
+						elem->params[1][i] = pParamPort->value();
+				}
+			}
+			drumkv1_sample *sample = elem0->gen1_sample.current();
+			if (sample) {
+				sample->ref();
+				samples[key] = sample;
+			}
+		}
+		set->elems[key] = elem;
+		set->list.append(elem);
+	}
+
+	m_update_mutex.unlock();
+
+	for (int note = 0; note < MAX_NOTES; ++note) {
+		if (elements[note])
+			load_elem(set->elems[note], elements[note], samples[note], iLoadQuality);
+		drumkv1_sample::unref(samples[note]);
+	}
+
+	return set;
+}
+
+
+// hand a new element set over, unless superseded by a later one;
+// swapped in at the next block boundary, or else right here, if
+// not processing (non-RT, update locked).
+bool drumkv1_impl::post_elem_set ( drumkv1_elem_set *set )
+{
+	if (int32_t(set->serial - m_update_last) < 0)
+		return false;
+
+	m_update_last = set->serial;
+
+	// detach the current element (param ports)
+	setCurrentElement(-1);
+
+	// owned by the old sets list from now on
+	m_elem_sets_mutex.lock();
+	m_elem_sets.append(set);
+	m_elem_sets_mutex.unlock();
+
+	if (m_running) {
+		// hand it over to the audio thread, swapped in at the next
+		// block boundary and followed up later by the reclaimer...
+		drumkv1_elem_set *pending = m_elem_set.exchange(set);
+		if (pending)
+			pending->retired.store(true, std::memory_order_release);
+	} else {
+		// not processing, swap it over right here...
+		drumkv1_elem_set *pending = m_elem_set.exchange(nullptr);
+		if (pending)
+			pending->retired.store(true, std::memory_order_release);
+		swap_elem_set(set);
+		m_swapped.store(false);
+		swapped_elem_set();
+		m_reclaim.schedule();
+	}
+
+	return true;
+}
+
+
+// load a new element from its kit snapshot (non-RT).
+void drumkv1_impl::load_elem ( drumkv1_elem *elem,
+	const drumkv1_kit::Element *pElement,
+	drumkv1_sample *sample0, int iLoadQuality )
+{
+	// defaults as of the kit; only the values that differ from the
+	// ones in place (the current element's, if any) get updated...
+	for (uint32_t i = 0; i < drumkv1::NUM_ELEMENT_PARAMS; ++i) {
+		const drumkv1::ParamIndex index = drumkv1::ParamIndex(i);
+		const float fValue = pElement->params[i];
+		elem->element.setParamValue(index, fValue, 0);
+		if (elem->element.paramValue(index) != fValue)
+			elem->element.setParamValue(index, fValue);
+	}
+
+	// pre-loaded sample, or else the one currently loaded on the
+	// same key, shared as long as still the same file, storage
+	// format and playback setup, as is (never changed once shared);
+	// otherwise load it right now...
+	const int key = pElement->key;
+	drumkv1_sample *sample = pElement->sample;
+	if (sample == nullptr)
+		sample = sample0;
+	if (sample && (sample->format() != drumkv1_sample::Format(m_sample_format)
+		|| sample->freq() != drumkv1_freq(key)
+		|| !pElement->isSampleSetup(sample)))
+		sample = nullptr;
+	if (sample) {
+		sample->ref();
+		elem->gen1_sample.append(sample);
+	}
+	else
+	if (!pElement->sampleFile.isEmpty()) {
+		sample = new drumkv1_sample(*elem->gen1_sample.current());
+		sample->setSampleRate(m_srate);
+		sample->setFormat(drumkv1_sample::Format(m_sample_format));
+		sample->setQuality(drumkv1_sample::Quality(iLoadQuality));
+		sample->open(pElement->sampleFile.constData(), drumkv1_freq(key));
+		pElement->setupSample(sample);
+		elem->gen1_sample.append(sample);
+	}
+
+	elem->updateEnvTimes(m_srate);
+}
+
+
+// swap the whole element set at a block boundary, leaving the old
+// one behind for the old voices to play on (or fade out) (RT safe).
+void drumkv1_impl::swap_elem_set ( drumkv1_elem_set *set )
+{
+	for (int note = 0; note < MAX_NOTES; ++note) {
+		drumkv1_elem *elem = m_elems[note];
+		m_elems[note] = set->elems[note];
+		set->elems[note] = elem;
+		m_notes[note] = nullptr;
+	}
+
+	for (int group = 0; group < MAX_GROUP; ++group)
+		m_group[group] = nullptr;
+
+	const drumkv1_list<drumkv1_elem> elem_list = m_elem_list;
+	m_elem_list = set->list;
+	set->list = elem_list;
+
+	const uint32_t xfade_frames = (set->xfade
+		? uint32_t(0.001f * XFADE_MSECS * m_srate) : 0);
+
+	int nvoices = 0;
+	drumkv1_voice *pv = m_play_list.next();
+	while (pv) {
+		if (pv->elem_set == nullptr) {
+			pv->elem_set = set;
+			++nvoices;
+		}
+		if (xfade_frames > 0 && pv->xfade_delta <= 0.0f) {
+			pv->xfade_frames = xfade_frames;
+			pv->xfade_delta = pv->xfade_gain / float(xfade_frames);
+		}
+		pv = pv->next();
+	}
+
+	set->nvoices.store(nvoices, std::memory_order_release);
+
+	m_swap_key0.store(set->key0);
+	m_swapped.store(true);
+
+	set->retired.store(true, std::memory_order_release);
+}
+
+
+// follow up on a swap: attach the current element and re-resample
+// whatever was not pre-loaded as of now (non-RT, serialized).
+void drumkv1_impl::swapped_elem_set (void)
+{
+	setCurrentElement(-1);
+	setCurrentElement(m_swap_key0.load());
+
+	resample_elems();
+}
+
+
+// follow up on the last swap and reclaim old element sets, once
+// no voice plays on them, unless another set is pending (non-RT).
+void drumkv1_impl::reclaimElements (void)
+{
+	drumkv1_list<drumkv1_elem_set> sets;
+
+	m_update_mutex.lock();
+
+	if (m_elem_set.load(std::memory_order_acquire) == nullptr) {
+		if (m_swapped.exchange(false)) {
+			swapped_elem_set();
+			drumkv1_sched::sync_notify(m_pDrumk, drumkv1_sched::Sample, 1);
+		}
+		take_elem_sets(sets);
+		// retired samples, no longer playing...
+		drumkv1_elem *elem = m_elem_list.next();
+		while (elem) {
+			elem->gen1_sample.free_refs();
+			elem = elem->next();
+		}
+	}
+
+	m_update_mutex.unlock();
+
+	free_elem_sets(sets);
+}
+
+
+// unlink old element sets, once no voice plays on them (non-RT).
+void drumkv1_impl::take_elem_sets (
+	drumkv1_list<drumkv1_elem_set>& sets, bool bForce )
+{
+	m_elem_sets_mutex.lock();
+
+	drumkv1_elem_set *set = m_elem_sets.next();
+	while (set) {
+		drumkv1_elem_set *set_next = set->next();
+		if (bForce || (set->retired.load(std::memory_order_acquire)
+				&& set->nvoices.load(std::memory_order_acquire) < 1)) {
+			m_elem_sets.remove(set);
+			sets.append(set);
+		}
+		set = set_next;
+	}
+
+	m_elem_sets_mutex.unlock();
+}
+
+
+// delete unlinked element sets; never while locked, as their
+// element scheds may wait on the instance queue (non-RT).
+void drumkv1_impl::free_elem_sets ( drumkv1_list<drumkv1_elem_set>& sets )
+{
+	drumkv1_elem_set *set = sets.next();
+	while (set) {
+		sets.remove(set);
+		delete set;
+		set = sets.next();
+	}
 }
 
 
@@ -1845,13 +2633,16 @@ void drumkv1_impl::process_midi ( uint8_t *data, uint32_t size )
 				pv->dca1_pre.reset(
 					m_def.pressure.value_ptr(),
 					&m_ctl.pressure, &pv->pre);
-				// generate
-				pv->gen1.start();
 				// frequencies
 				const float gen1_tuning
 					= *elem->gen1.coarse * COARSE_SCALE
 					+ *elem->gen1.fine * FINE_SCALE;
 				pv->gen1_freq = m_freqs[key] * drumkv1_freq2(gen1_tuning);
+				// generate (octave level)
+				const float gen1_freq = pv->gen1_freq * m_ctl.pitchbend;
+				if (pv->gen1.sample()->requestLevel(gen1_freq))
+					elem->gen1.schedule(drumkv1::GEN1_COARSE);
+				pv->gen1.start(gen1_freq);
 				// filters
 				const int dcf1_type = int(*elem->dcf1.type);
 				pv->dcf11.reset(drumkv1_filter1::Type(dcf1_type));
@@ -2148,6 +2939,12 @@ drumkv1_programs *drumkv1_impl::programs (void)
 }
 
 
+drumkv1_sched_notifiers *drumkv1_impl::notifiers (void)
+{
+	return &m_notifiers;
+}
+
+
 // Micro-tuning support
 
 void drumkv1_impl::setTuningEnabled ( bool enabled )
@@ -2263,16 +3060,25 @@ void drumkv1_impl::reset (void)
 	resetElements();
 
 	// flangers
-	if (m_flanger == nullptr)
+	if (m_flanger == nullptr) {
 		m_flanger = new drumkv1_fx_flanger [m_nchannels];
+		drumkv1_mlock::lock(m_flanger,
+			m_nchannels * sizeof(drumkv1_fx_flanger));
+	}
 
 	// phasers
 	if (m_phaser == nullptr)
 		m_phaser = new drumkv1_fx_phaser [m_nchannels];
 
 	// delays
-	if (m_delay == nullptr)
+	if (m_delay == nullptr) {
 		m_delay = new drumkv1_fx_delay [m_nchannels];
+		drumkv1_mlock::lock(m_delay,
+			m_nchannels * sizeof(drumkv1_fx_delay));
+	}
+
+	// chorus delay lines
+	drumkv1_mlock::lock(&m_chorus, sizeof(m_chorus));
 
 	// compressors
 	if (m_comp == nullptr)
@@ -2309,6 +3115,15 @@ void drumkv1_impl::process ( float **ins, float **outs, uint32_t nframes )
 {
 	if (!m_running) return;
 
+	// swap in a new element set (kit), if pending...
+	if (m_elem_set.load(std::memory_order_acquire)) {
+		drumkv1_elem_set *set = m_elem_set.exchange(nullptr);
+		if (set) {
+			swap_elem_set(set);
+			m_reclaim.schedule();
+		}
+	}
+
 	float *v_outs[m_nchannels];
 	float *v_sfxs[m_nchannels];
 
@@ -2341,8 +3156,18 @@ void drumkv1_impl::process ( float **ins, float **outs, uint32_t nframes )
 			elem->gen1.envtime0  = *elem->gen1.envtime;
 			elem->updateEnvTimes(m_srate);
 		}
+		if (elem->gen1.coarse0 != *elem->gen1.coarse) {
+			elem->gen1.coarse0  = *elem->gen1.coarse;
+			const float gen1_tuning
+				= elem->gen1.coarse0 * COARSE_SCALE
+				+ *elem->gen1.fine * FINE_SCALE;
+			const float gen1_freq = m_freqs[elem->gen1.key()]
+				* drumkv1_freq2(gen1_tuning);
+			if (elem->gen1_sample.current()->requestLevel(gen1_freq))
+				elem->gen1.schedule(drumkv1::GEN1_COARSE);
+		}
 		if (*elem->lfo1.enabled > 0.0f) {
-			elem->lfo1_wave.reset_test(
+			elem->lfo1_wave_test(
 				drumkv1_wave::Shape(*elem->lfo1.shape), *elem->lfo1.width);
 		}
 		elem = elem->next();
@@ -2374,7 +3199,7 @@ void drumkv1_impl::process ( float **ins, float **outs, uint32_t nframes )
 		// channel indexes
 
 		const uint16_t k1 = 0;
-		const uint16_t k2 = (elem->gen1_sample.next()->channels() > 1 ? 1 : 0);
+		const uint16_t k2 = (pv->gen1.sample()->channels() > 1 ? 1 : 0);
 
 		// output buffers
 
@@ -2397,6 +3222,13 @@ void drumkv1_impl::process ( float **ins, float **outs, uint32_t nframes )
 				ngen = pv->dcf1_env.frames;
 			if (pv->lfo1_env.running && pv->lfo1_env.frames < ngen)
 				ngen = pv->lfo1_env.frames;
+			if (pv->xfade_frames > 0 && pv->xfade_frames < ngen)
+				ngen = pv->xfade_frames;
+
+			// unity step (native pitch) run, unless LFO pitch modulated
+
+			const bool gen1_unity = (modwheel1 == 0.0f
+				&& pv->gen1.isUnity(pv->gen1_freq * m_ctl.pitchbend));
 
 			for (uint32_t j = 0; j < ngen; ++j) {
 
@@ -2412,11 +3244,17 @@ void drumkv1_impl::process ( float **ins, float **outs, uint32_t nframes )
 				const float lfo1
 					= (lfo1_enabled ? pv->lfo1_sample * lfo1_env : 0.0f);
 
-				pv->gen1.next(pv->gen1_freq
-					* (m_ctl.pitchbend + modwheel1 * lfo1));
-
-				float gen1 = pv->gen1.value(k1);
-				float gen2 = pv->gen1.value(k2);
+				float gen1, gen2;
+				if (gen1_unity) {
+					pv->gen1.next1();
+					gen1 = pv->gen1.value1(k1);
+					gen2 = pv->gen1.value1(k2);
+				} else {
+					pv->gen1.next(pv->gen1_freq
+						* (m_ctl.pitchbend + modwheel1 * lfo1));
+					gen1 = pv->gen1.value(k1);
+					gen2 = pv->gen1.value(k2);
+				}
 
 				if (lfo1_enabled) {
 					pv->lfo1_sample = pv->lfo1.sample(lfo1_freq
@@ -2460,7 +3298,10 @@ void drumkv1_impl::process ( float **ins, float **outs, uint32_t nframes )
 				const float sid1 = 0.5f * (gen1 - gen2);
 				const float vol1 = vel1 * elem->vol1.value(j)
 					* pv->dca1_env.tick()
-					* pv->out1_vol.value(j);
+					* pv->out1_vol.value(j)
+					* pv->xfade_gain;
+
+				pv->xfade_gain -= pv->xfade_delta;
 
 				// outputs
 
@@ -2492,13 +3333,17 @@ void drumkv1_impl::process ( float **ins, float **outs, uint32_t nframes )
 			pv->out1_pan.process(ngen);
 			pv->out1_vol.process(ngen);
 
+			if (pv->xfade_frames > 0)
+				pv->xfade_frames -= ngen;
+
 			// envelope countdowns
 
 			if (pv->dca1_env.running && pv->dca1_env.frames == 0)
 				elem->dca1.env.next(&pv->dca1_env);
 
 			if (pv->gen1.isOver() ||
-				pv->dca1_env.stage == drumkv1_env::End) {
+				pv->dca1_env.stage == drumkv1_env::End ||
+				(pv->xfade_delta > 0.0f && pv->xfade_frames == 0)) {
 				if (pv->note >= 0)
 					m_notes[pv->note] = nullptr;
 				if (pv->group >= 0 && m_group[pv->group] == pv)
@@ -2631,8 +3476,12 @@ bool drumkv1_impl::running ( bool on )
 //
 
 drumkv1::drumkv1 ( uint16_t nchannels, float srate, uint32_t nsize )
+	: m_pImpl(nullptr)
 {
 	m_pImpl = new drumkv1_impl(this, nchannels, srate, nsize);
+
+	// pre-load programs, in the background...
+	m_pImpl->programs()->preload();
 }
 
 
@@ -2666,6 +3515,12 @@ float drumkv1::sampleRate (void) const
 }
 
 
+float drumkv1::resampleProgress (void) const
+{
+	return m_pImpl->resampleProgress();
+}
+
+
 void drumkv1::setBufferSize ( uint32_t nsize )
 {
 	m_pImpl->setBufferSize(nsize);
@@ -2736,6 +3591,18 @@ void drumkv1::clearElements (void)
 }
 
 
+void drumkv1::applyKit ( const drumkv1_kit *pKit, bool bXfade )
+{
+	m_pImpl->applyKit(pKit, bXfade);
+}
+
+
+void drumkv1::updateElements ( const drumkv1_kit *pKit, bool bXfade )
+{
+	m_pImpl->updateElements(pKit, bXfade);
+}
+
+
 void drumkv1::setSampleFile ( const char *pszSampleFile, bool bSync )
 {
 	m_pImpl->setSampleFile(pszSampleFile);
@@ -2805,6 +3672,30 @@ uint32_t drumkv1::offsetEnd (void) const
 }
 
 
+void drumkv1::setSampleFormat ( int iSampleFormat )
+{
+	m_pImpl->setSampleFormat(iSampleFormat);
+}
+
+
+int drumkv1::sampleFormat (void) const
+{
+	return m_pImpl->sampleFormat();
+}
+
+
+void drumkv1::setResampleQuality ( int iResampleQuality )
+{
+	m_pImpl->setResampleQuality(iResampleQuality);
+}
+
+
+int drumkv1::resampleQuality (void) const
+{
+	return m_pImpl->resampleQuality();
+}
+
+
 void drumkv1::setTempo ( float bpm )
 {
 	m_pImpl->setTempo(bpm);
@@ -2884,6 +3775,14 @@ drumkv1_programs *drumkv1::programs (void) const
 }
 
 
+// scheduler notifiers accessor
+
+drumkv1_sched_notifiers *drumkv1::notifiers (void) const
+{
+	return (m_pImpl ? m_pImpl->notifiers() : nullptr);
+}
+
+
 // process state
 
 bool drumkv1::running ( bool on )
@@ -2927,72 +3826,110 @@ int drumkv1_element::note (void) const
 void drumkv1_element::setSampleFile ( const char *pszSampleFile )
 {
 	if (m_pElem) {
-		drumkv1_sample *prev = m_pElem->gen1_sample.prev();
+		drumkv1_sample *prev = m_pElem->gen1_sample.current();
 		drumkv1_sample *next = new drumkv1_sample(*prev);
+		drumkv1 *pDrumk = m_pElem->gen1.instance();
+		next->setSampleRate(pDrumk->sampleRate());
+		next->setFormat(drumkv1_sample::Format(pDrumk->sampleFormat()));
+		next->setQuality(drumkv1_sample::Quality(pDrumk->resampleQuality()));
 		if (pszSampleFile)
 			next->open(pszSampleFile, drumkv1_freq(m_pElem->gen1.sample0));
+		else
+			next->close();
 		m_pElem->gen1_sample.append(next);
-		m_pElem->gen1_sample.free_refs();
-		m_pElem->gen1_sample.clear_refs();
 	}
 }
 
 
 const char *drumkv1_element::sampleFile (void) const
 {
-	return (m_pElem ? m_pElem->gen1_sample.prev()->filename() : nullptr);
+	return (m_pElem ? m_pElem->gen1_sample.current()->filename() : nullptr);
 }
 
 
 drumkv1_sample *drumkv1_element::sample (void) const
 {
-	return (m_pElem ? m_pElem->gen1_sample.prev() : nullptr);
+	return (m_pElem ? m_pElem->gen1_sample.current() : nullptr);
 }
 
 
 uint32_t drumkv1_element::length (void) const
 {
-	return (m_pElem ? m_pElem->gen1_sample.prev()->length() : 0);
+	return (m_pElem ? m_pElem->gen1_sample.current()->length() : 0);
+}
+
+
+uint32_t drumkv1_element::trimStart (void) const
+{
+	return (m_pElem ? m_pElem->gen1_sample.current()->trimStart() : 0);
+}
+
+
+// copy-on-write: shared samples (eg. pre-loaded kits) are never
+// changed, a private copy is re-opened and published instead (non-RT).
+static drumkv1_sample *drumkv1_elem_sample_write ( drumkv1_elem *elem )
+{
+	drumkv1_sample *sample = elem->gen1_sample.current();
+	if (sample->isShared()) {
+		drumkv1_sample *next = new drumkv1_sample(*sample);
+		next->open(sample->filename(), sample->freq());
+		elem->gen1_sample.append(next);
+		sample = next;
+	}
+	return sample;
 }
 
 
 void drumkv1_element::setReverse ( bool bReverse )
 {
-	if (m_pElem) m_pElem->gen1_sample.prev()->setReverse(bReverse);
+	if (m_pElem == nullptr)
+		return;
+
+	if (m_pElem->gen1_sample.current()->isReverse() != bReverse)
+		drumkv1_elem_sample_write(m_pElem)->setReverse(bReverse);
 }
 
 
 bool drumkv1_element::isReverse (void) const
 {
-	return (m_pElem ? m_pElem->gen1_sample.prev()->isReverse() : false);
+	return (m_pElem ? m_pElem->gen1_sample.current()->isReverse() : false);
 }
 
 
 void drumkv1_element::setOffset ( bool bOffset )
 {
-	if (m_pElem) m_pElem->gen1_sample.prev()->setOffset(bOffset);
+	if (m_pElem == nullptr)
+		return;
+
+	if (m_pElem->gen1_sample.current()->isOffset() != bOffset)
+		drumkv1_elem_sample_write(m_pElem)->setOffset(bOffset);
 }
 
 bool drumkv1_element::isOffset (void) const
 {
-	return (m_pElem ? m_pElem->gen1_sample.prev()->isOffset() : false);
+	return (m_pElem ? m_pElem->gen1_sample.current()->isOffset() : false);
 }
 
 
 void drumkv1_element::setOffsetRange ( uint32_t iOffsetStart, uint32_t iOffsetEnd )
 {
-	if (m_pElem)
-		m_pElem->gen1_sample.prev()->setOffsetRange(iOffsetStart, iOffsetEnd);
+	if (m_pElem == nullptr)
+		return;
+
+	drumkv1_sample *sample = m_pElem->gen1_sample.current();
+	if (sample->offsetStart() != iOffsetStart
+		|| sample->offsetEnd() != iOffsetEnd)
+		drumkv1_elem_sample_write(m_pElem)->setOffsetRange(iOffsetStart, iOffsetEnd);
 }
 
 uint32_t drumkv1_element::offsetStart (void) const
 {
-	return (m_pElem ? m_pElem->gen1_sample.prev()->offsetStart() : 0);
+	return (m_pElem ? m_pElem->gen1_sample.current()->offsetStart() : 0);
 }
 
 uint32_t drumkv1_element::offsetEnd (void) const
 {
-	return (m_pElem ? m_pElem->gen1_sample.prev()->offsetEnd() : 0);
+	return (m_pElem ? m_pElem->gen1_sample.current()->offsetEnd() : 0);
 }
 
 
@@ -3118,7 +4055,7 @@ void drumkv1_element::sampleReverseSync (void)
 		return;
 
 	const bool bReverse
-		= m_pElem->gen1_sample.prev()->isReverse();
+		= m_pElem->gen1_sample.current()->isReverse();
 
 	m_pElem->gen1.reverse.set_value_sync(bReverse ? 1.0f : 0.0f);
 }
@@ -3142,7 +4079,7 @@ void drumkv1_element::sampleOffsetSync (void)
 		return;
 
 	const bool bOffset
-		= m_pElem->gen1_sample.prev()->isOffset();
+		= m_pElem->gen1_sample.current()->isOffset();
 
 	m_pElem->gen1.offset.set_value_sync(bOffset ? 1.0f : 0.0f);
 }
@@ -3154,11 +4091,11 @@ void drumkv1_element::sampleOffsetRangeSync (void)
 		return;
 
 	const uint32_t iSampleLength
-		= m_pElem->gen1_sample.prev()->length();
+		= m_pElem->gen1_sample.current()->length();
 	const uint32_t iOffsetStart
-		= m_pElem->gen1_sample.prev()->offsetStart();
+		= m_pElem->gen1_sample.current()->offsetStart();
 	const uint32_t iOffsetEnd
-		= m_pElem->gen1_sample.prev()->offsetEnd();
+		= m_pElem->gen1_sample.current()->offsetEnd();
 
 	const float fOffset_1 = (iSampleLength > 0
 		? float(iOffsetStart) / float(iSampleLength)
@@ -3177,7 +4114,14 @@ void drumkv1_element::sampleOffsetRangeSync (void)
 void drumkv1_element::updateEnvTimes (void)
 {
 	if (m_pElem)
-		m_pElem->updateEnvTimes(m_pElem->gen1_sample.next()->sampleRate());
+		m_pElem->updateEnvTimes(m_pElem->gen1_sample.current()->sampleRate());
+}
+
+
+void drumkv1_element::updateLfoWave (void)
+{
+	if (m_pElem)
+		m_pElem->updateLfoWave();
 }
 
 
@@ -35,6 +35,8 @@ class drumkv1_element;
 class drumkv1_sample;
 class drumkv1_controls;
 class drumkv1_programs;
+class drumkv1_sched_notifiers;
+class drumkv1_kit;
 
 
 //-------------------------------------------------------------------------
@@ -55,6 +57,9 @@ public:
 	void setSampleRate(float srate);
 	float sampleRate() const;
 
+	// background re-resampling progress (0..1).
+	float resampleProgress() const;
+
 	void setBufferSize(uint32_t nsize);
 	uint32_t bufferSize() const;
 
@@ -71,6 +76,13 @@ public:
 	void resetElements();
 	void clearElements();
 
+	// swap in a pre-decoded kit, optionally fading out ringing voices.
+	void applyKit(const drumkv1_kit *pKit, bool bXfade = false);
+
+	// swap in a new element set from the kit elements, as a diff
+	// reusing already loaded samples; old voices play on the old set.
+	void updateElements(const drumkv1_kit *pKit, bool bXfade = false);
+
 	void setSampleFile(const char *pszSampleFile, bool bSync = false);
 	const char *sampleFile() const;
 
@@ -86,6 +98,12 @@ public:
 	uint32_t offsetStart() const;
 	uint32_t offsetEnd() const;
 
+	void setSampleFormat(int iSampleFormat);
+	int sampleFormat() const;
+
+	void setResampleQuality(int iResampleQuality);
+	int resampleQuality() const;
+
 	void setTempo(float bpm);
 	float tempo() const;
 
@@ -190,6 +208,8 @@ public:
 	drumkv1_controls *controls() const;
 	drumkv1_programs *programs() const;
 
+	drumkv1_sched_notifiers *notifiers() const;
+
 	void process_midi(uint8_t *data, uint32_t size);
 	void process(float **ins, float **outs, uint32_t nframes);
 
@@ -250,6 +270,7 @@ public:
 
 	drumkv1_sample *sample() const;
 	uint32_t length() const;
+	uint32_t trimStart() const;
 
 	void setReverse(bool bReverse);
 	bool isReverse() const;
@@ -277,6 +298,7 @@ public:
 	void sampleOffsetRangeSync();
 
 	void updateEnvTimes();
+	void updateLfoWave();
 
 private:
 
@@ -350,12 +350,14 @@ void drumkv1_config::loadPrograms ( drumkv1_programs *pPrograms )
 	QSettings::endGroup();
 
 	pPrograms->enabled(bProgramsEnabled);
+	pPrograms->crossfade(bProgramsCrossfade);
 }
 
 
 void drumkv1_config::savePrograms ( drumkv1_programs *pPrograms )
 {
 	bProgramsEnabled = pPrograms->enabled();
+	bProgramsCrossfade = pPrograms->crossfade();
 
 	clearPrograms();
 
@@ -513,8 +515,16 @@ void drumkv1_config::load (void)
 	iFrameTimeFormat = QSettings::value("/FrameTimeFormat", 0).toInt();
 	fRandomizePercent = QSettings::value("/RandomizePercent", 20.0f).toFloat();
 	bUseGMDrumNames = QSettings::value("/UseGMDrumNames", true).toBool();
+	iSampleFormat = QSettings::value("/SampleFormat", 0).toInt();
+	iResampleQuality = QSettings::value("/ResampleQuality", 1).toInt();
+	bResampleProgressive = QSettings::value("/ResampleProgressive", false).toBool();
+	bSilenceTrim = QSettings::value("/SilenceTrim", false).toBool();
+	fSilenceThreshold = QSettings::value("/SilenceThreshold", -90.0f).toFloat();
+	bMemoryLock = QSettings::value("/MemoryLock", false).toBool();
+	bHugePages = QSettings::value("/HugePages", false).toBool();
 	bControlsEnabled = QSettings::value("/ControlsEnabled", false).toBool();
 	bProgramsEnabled = QSettings::value("/ProgramsEnabled", false).toBool();
+	bProgramsCrossfade = QSettings::value("/ProgramsCrossfade", true).toBool();
 	QSettings::endGroup();
 
 	QSettings::beginGroup("/Dialogs");
@@ -561,8 +571,16 @@ void drumkv1_config::save (void)
 	QSettings::setValue("/FrameTimeFormat", iFrameTimeFormat);
 	QSettings::setValue("/RandomizePercent", fRandomizePercent);
 	QSettings::setValue("/UseGMDrumNames", bUseGMDrumNames);
+	QSettings::setValue("/SampleFormat", iSampleFormat);
+	QSettings::setValue("/ResampleQuality", iResampleQuality);
+	QSettings::setValue("/ResampleProgressive", bResampleProgressive);
+	QSettings::setValue("/SilenceTrim", bSilenceTrim);
+	QSettings::setValue("/SilenceThreshold", fSilenceThreshold);
+	QSettings::setValue("/MemoryLock", bMemoryLock);
+	QSettings::setValue("/HugePages", bHugePages);
 	QSettings::setValue("/ControlsEnabled", bControlsEnabled);
 	QSettings::setValue("/ProgramsEnabled", bProgramsEnabled);
+	QSettings::setValue("/ProgramsCrossfade", bProgramsCrossfade);
 	QSettings::endGroup();
 
 	QSettings::beginGroup("/Dialogs");
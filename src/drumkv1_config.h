@@ -67,9 +67,30 @@ public:
 	// Whether to display GM Standard drum-note/key names.
 	bool bUseGMDrumNames;
 
+	// Default sample storage format
+	// (0=float32, 1=int16, 2=half-float, 3=compressed 24-bit).
+	int iSampleFormat;
+
+	// Default resampler quality profile
+	// (0=draft, 1=medium, 2=high, 3=best),
+	// and whether kits load as draft first,
+	// upgrading in the background.
+	int  iResampleQuality;
+	bool bResampleProgressive;
+
+	// Sample silence trimming on load (threshold in dB).
+	bool  bSilenceTrim;
+	float fSilenceThreshold;
+
+	// Prefault and lock (mlock) sample, table and delay-line
+	// memory, optionally hinting transparent huge-pages.
+	bool bMemoryLock;
+	bool bHugePages;
+
 	// Special persistent options.
 	bool bControlsEnabled;
 	bool bProgramsEnabled;
+	bool bProgramsCrossfade;
 	bool bProgramsPreview;
 	bool bPresetsPreview;
 	bool bUseNativeDialogs;
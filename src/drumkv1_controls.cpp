@@ -21,7 +21,7 @@
 
 #include "drumkv1_controls.h"
 
-#include <QHash>
+#include <QThread>
 
 
 #define RPN_MSB   0x65
@@ -188,7 +188,31 @@ private:
 	xrpn_data14    m_value;
 };
 
-typedef QHash<unsigned int, xrpn_item> xrpn_cache;
+//---------------------------------------------------------------------
+// xrpn_cache - decl. (per MIDI channel state, preallocated)
+//
+class xrpn_cache
+{
+public:
+
+	static const unsigned int NUM_CHANNELS = 16;
+
+	xrpn_item& item ( unsigned short channel )
+		{ return m_items[channel & (NUM_CHANNELS - 1)]; }
+
+	xrpn_item& at ( unsigned int i )
+		{ return m_items[i]; }
+
+	void clear()
+	{
+		for (unsigned int i = 0; i < NUM_CHANNELS; ++i)
+			m_items[i].clear();
+	}
+
+private:
+
+	xrpn_item m_items[NUM_CHANNELS];
+};
 
 
 //---------------------------------------------------------------------
@@ -260,10 +284,9 @@ public:
 		return push(event);
 	}
 
+	// fixed size, preallocated (RT safe).
 	bool push ( const drumkv1_controls::Event& event )
 	{
-		if (count() >= m_mask)
-			resize(m_size + 4);
 		const unsigned int w = (m_write + 1) & m_mask;
 		if (w == m_read)
 			return false;
@@ -312,7 +335,7 @@ class drumkv1_controls::Impl
 {
 public:
 
-	Impl() : m_count(0) {}
+	Impl() : m_count(0), m_queue(1024) {}
 
 	bool is_pending () const
 		{ return m_queue.is_pending(); }
@@ -323,10 +346,8 @@ public:
 	void flush()
 	{
 		if (m_count > 0) {
-			xrpn_cache::Iterator iter = m_cache.begin();
-			const xrpn_cache::Iterator& iter_end = m_cache.end();
-			for ( ; iter != iter_end; ++iter)
-				enqueue(iter.value());
+			for (unsigned int i = 0; i < xrpn_cache::NUM_CHANNELS; ++i)
+				enqueue(m_cache.at(i));
 			m_cache.clear();
 		//	m_count = 0;
 		}
@@ -502,7 +523,7 @@ public:
 protected:
 
 	xrpn_item& get_item ( unsigned short channel )
-		{ return m_cache[channel]; }
+		{ return m_cache.item(channel); }
 
 	void enqueue ( xrpn_item& item )
 	{
@@ -566,6 +587,131 @@ private:
 };
 
 
+//---------------------------------------------------------------------
+// drumkv1_controls::Table - decl.
+//
+// Flat [type][channel][param] lookup for 7-bit params (CC, CC14),
+// open-addressed hash for 14-bit ones (RPN, NRPN); built off the RT
+// thread whenever the map changes, then looked up in O(1).
+
+class drumkv1_controls::Table
+{
+public:
+
+	Table(const Map& map, Table *prev);
+	~Table();
+
+	// lookup (RT safe).
+	Data *find(const Key& key) const;
+
+	// all payload.
+	Data *data(int i) const
+		{ return &m_data[i]; }
+	int count() const
+		{ return m_ndata; }
+
+private:
+
+	static const int NUM_CHANNELS = 17; // 0=auto, 1..16.
+
+	struct Slot
+	{
+		Key key;
+		int idata;
+	};
+
+	int      m_ndata;
+	Data    *m_data;
+
+	short    m_cc[2][NUM_CHANNELS][128];
+
+	unsigned int m_nslots;
+	unsigned int m_mask;
+	Slot        *m_slots;
+};
+
+
+static inline unsigned int drumkv1_controls_hash (
+	const drumkv1_controls::Key& key )
+{
+	return (((unsigned int) key.status << 14) ^ key.param) * 2654435761U;
+}
+
+
+drumkv1_controls::Table::Table ( const Map& map, Table *prev )
+{
+	m_ndata = map.count();
+	m_data = new Data [m_ndata > 0 ? m_ndata : 1];
+
+	::memset(m_cc, 0xff, sizeof(m_cc));
+
+	m_nslots = 16;
+	while (m_nslots < (unsigned int) (m_ndata << 1))
+		m_nslots <<= 1;
+	m_mask = m_nslots - 1;
+	m_slots = new Slot [m_nslots];
+	for (unsigned int i = 0; i < m_nslots; ++i)
+		m_slots[i].idata = -1;
+
+	int i = 0;
+	Map::ConstIterator iter = map.constBegin();
+	const Map::ConstIterator& iter_end = map.constEnd();
+	for ( ; iter != iter_end; ++iter, ++i) {
+		const Key& key = iter.key();
+		Data& data = m_data[i];
+		data = iter.value();
+		// keep catch-up state across rebuilds...
+		Data *pPrev = (prev ? prev->find(key) : nullptr);
+		if (pPrev && pPrev->index == data.index) {
+			data.val  = pPrev->val;
+			data.sync = pPrev->sync;
+		}
+		const Type ctype = key.type();
+		const unsigned short channel = key.channel();
+		if (ctype == CC || ctype == CC14) {
+			if (channel < NUM_CHANNELS && key.param < 128)
+				m_cc[ctype == CC ? 0 : 1][channel][key.param] = short(i);
+		} else {
+			unsigned int h = drumkv1_controls_hash(key) & m_mask;
+			while (m_slots[h].idata >= 0)
+				h = (h + 1) & m_mask;
+			m_slots[h].key = key;
+			m_slots[h].idata = i;
+		}
+	}
+}
+
+
+drumkv1_controls::Table::~Table (void)
+{
+	delete [] m_slots;
+	delete [] m_data;
+}
+
+
+drumkv1_controls::Data *drumkv1_controls::Table::find ( const Key& key ) const
+{
+	const Type ctype = key.type();
+	const unsigned short channel = key.channel();
+	if (ctype == CC || ctype == CC14) {
+		if (channel >= NUM_CHANNELS || key.param >= 128)
+			return nullptr;
+		const int i = m_cc[ctype == CC ? 0 : 1][channel][key.param];
+		return (i >= 0 ? &m_data[i] : nullptr);
+	}
+
+	unsigned int h = drumkv1_controls_hash(key) & m_mask;
+	while (m_slots[h].idata >= 0) {
+		const Slot& slot = m_slots[h];
+		if (slot.key.status == key.status && slot.key.param == key.param)
+			return &m_data[slot.idata];
+		h = (h + 1) & m_mask;
+	}
+
+	return nullptr;
+}
+
+
 //---------------------------------------------------------------------
 // drumkv1_controls - impl.
 //
@@ -573,17 +719,37 @@ private:
 drumkv1_controls::drumkv1_controls ( drumkv1 *pDrumk )
 	: m_pImpl(new drumkv1_controls::Impl()), m_enabled(false),
 		m_sched_in(pDrumk), m_sched_out(pDrumk),
+		m_table(nullptr), m_table_readers(0),
 		m_timeout(0), m_timein(0)
 {
+	update_table();
 }
 
 
 drumkv1_controls::~drumkv1_controls (void)
 {
+	delete m_table.exchange(nullptr);
+
 	delete m_pImpl;
 }
 
 
+// rebuild the controller lookup table (non-RT).
+void drumkv1_controls::update_table (void)
+{
+	Table *pOldTable = m_table.load();
+	Table *pNewTable = new Table(m_map, pOldTable);
+
+	m_table.store(pNewTable);
+
+	// wait for any RT lookup still in flight...
+	while (m_table_readers.load() > 0)
+		QThread::yieldCurrentThread();
+
+	delete pOldTable;
+}
+
+
 // controller queue methods.
 void drumkv1_controls::process_enqueue (
 	unsigned short channel, unsigned short param, unsigned short value )
@@ -625,20 +791,26 @@ void drumkv1_controls::process_event ( const Event& event )
 
 	m_sched_in.schedule_key(key);
 
-	const Map::Iterator& iter_end = m_map.end();
-	Map::Iterator iter = m_map.find(key);
-	if (iter == iter_end && key.channel() > 0) {
+	m_table_readers.fetch_add(1);
+
+	Table *pTable = m_table.load();
+	Data *pData = (pTable ? pTable->find(key) : nullptr);
+	if (pData == nullptr && pTable && key.channel() > 0) {
 		key.status = key.type(); // channel=0 (Auto)
-		iter = m_map.find(key);
+		pData = pTable->find(key);
 	}
-	if (iter == iter_end)
-		return;
+	if (pData)
+		process_data(key, event.value, *pData);
 
-	// reference to payload...
-	Data& data = iter.value();
+	m_table_readers.fetch_sub(1);
+}
 
+
+void drumkv1_controls::process_data (
+	const Key& key, unsigned short value, Data& data )
+{
 	// process controller event...
-	float fScale = float(event.value) / 127.0f;
+	float fScale = float(value) / 127.0f;
 	if (key.type() != CC)
 		fScale /= 127.0f;
 
@@ -683,16 +855,18 @@ void drumkv1_controls::process_event ( const Event& event )
 // process timer counter.
 void drumkv1_controls::process ( unsigned int nframes )
 {
-	if (!enabled() || m_timeout < 1)
-		return;
-
-	m_timein += nframes;
-
-	if (m_timein > m_timeout) {
-		m_timein = 0;
-		m_pImpl->flush();
-		process_dequeue();
+	if (enabled() && m_timeout > 0) {
+		m_timein += nframes;
+		if (m_timein > m_timeout) {
+			m_timein = 0;
+			m_pImpl->flush();
+			process_dequeue();
+		}
 	}
+
+	// publish this block's controller changes, coalesced...
+	m_sched_in.schedule_flush();
+	m_sched_out.schedule_flush();
 }
 
 
@@ -702,10 +876,13 @@ void drumkv1_controls::reset (void)
 	if (!enabled())
 		return;
 
-	const Map::Iterator& iter_end = m_map.end();
-	Map::Iterator iter = m_map.begin();
-	for ( ; iter != iter_end; ++iter) {
-		Data& data = iter.value();
+	Table *pTable = m_table.load();
+	if (pTable == nullptr)
+		return;
+
+	const int ndata = pTable->count();
+	for (int i = 0; i < ndata; ++i) {
+		Data& data = *pTable->data(i);
 		if (data.flags & Hook)
 			continue;
 		const drumkv1::ParamIndex index
@@ -27,6 +27,8 @@
 
 #include <QMap>
 
+#include <atomic>
+
 
 //-------------------------------------------------------------------------
 // drumkv1_controls - Controller processs class.
@@ -115,11 +117,11 @@ public:
 	int find_control(const Key& key) const
 		{ return m_map.value(key).index; }
 	void add_control(const Key& key, const Data& data)
-		{ m_map.insert(key, data); }
+		{ m_map.insert(key, data); update_table(); }
 	void remove_control(const Key& key)
-		{ m_map.remove(key); }
+		{ m_map.remove(key); update_table(); }
 
-	void clear() { m_map.clear(); }
+	void clear() { m_map.clear(); update_table(); }
 
 	// reset all controllers.
 	void reset();
@@ -146,6 +148,10 @@ protected:
 
 	// controller action.
 	void process_event(const Event& event);
+	void process_data(const Key& key, unsigned short value, Data& data);
+
+	// rebuild the controller lookup table (non-RT).
+	void update_table();
 
 	// input controller scheduled events (learn)
 	class SchedIn : public drumkv1_sched
@@ -154,10 +160,19 @@ protected:
 
 		// ctor.
 		SchedIn (drumkv1 *pDrumk)
-			: drumkv1_sched(pDrumk, Controller) {}
+			: drumkv1_sched(pDrumk, Controller), m_pending(false) {}
 
+		// latch the last key, published once per block (RT).
 		void schedule_key(const Key& key)
-			{ m_key = key; schedule(); }
+			{ m_key = key; m_pending = true; }
+
+		void schedule_flush()
+		{
+			if (m_pending) {
+				m_pending = false;
+				schedule();
+			}
+		}
 
 		// process (virtual stub).
 		void process(int) {}
@@ -169,7 +184,8 @@ protected:
 	private:
 
 		// instance variables,.
-		Key m_key;
+		Key  m_key;
+		bool m_pending;
 	};
 
 	// output controller scheduled events (assignments)
@@ -179,29 +195,43 @@ protected:
 
 		// ctor.
 		SchedOut (drumkv1 *pDrumk)
-			: drumkv1_sched(pDrumk, Controls), m_value(0.0f) {}
+			: drumkv1_sched(pDrumk, Controls)
+			{ for (int i = 0; i < NUM_DIRTY; ++i) m_dirty[i] = 0; }
 
+		// apply the value right away, mark it for publication (RT).
 		void schedule_event(drumkv1::ParamIndex index, float value)
 		{
-			if (qAbs(value - m_value) > 0.001f) {
-				m_value = value;
-				schedule(int(index));
+			drumkv1 *pDrumk = instance();
+			if (qAbs(value - pDrumk->paramValue(index)) > 0.001f) {
+				pDrumk->setParamValue(index, value);
+				m_dirty[index >> 5] |= (1U << (index & 31));
 			}
 		}
 
-		// process (virtual stub).
-		void process(int sid)
+		// publish the changed params, once per block (RT).
+		void schedule_flush()
 		{
-			drumkv1 *pDrumk = instance();
-			drumkv1::ParamIndex index = drumkv1::ParamIndex(sid);
-			pDrumk->setParamValue(index, m_value);
-			pDrumk->updateParam(index);
+			for (int i = 0; i < NUM_DIRTY; ++i) {
+				uint32_t dirty = m_dirty[i];
+				m_dirty[i] = 0;
+				while (dirty) {
+					const int n = __builtin_ctz(dirty);
+					dirty &= dirty - 1;
+					schedule((i << 5) + n);
+				}
+			}
 		}
 
+		// process (virtual stub).
+		void process(int sid)
+			{ instance()->updateParam(drumkv1::ParamIndex(sid)); }
+
 	private:
 
 		// instance variables
-		float m_value;
+		static const int NUM_DIRTY = (drumkv1::NUM_PARAMS + 31) >> 5;
+
+		uint32_t m_dirty[NUM_DIRTY];
 	};
 
 private:
@@ -221,6 +251,12 @@ private:
 	// controllers map.
 	Map m_map;
 
+	// controller lookup table (RT snapshot of the map).
+	class Table;
+
+	std::atomic<Table *> m_table;
+	std::atomic<unsigned int> m_table_readers;
+
 	// frame timers.
 	unsigned int m_timeout;
 	unsigned int m_timein;
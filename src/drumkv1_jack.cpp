@@ -122,6 +122,17 @@ static int drumkv1_jack_buffer_size ( jack_nframes_t nframes, void *arg )
 }
 
 
+//----------------------------------------------------------------------
+// JACK sample-rate change callback.
+
+static int drumkv1_jack_sample_rate ( jack_nframes_t nframes, void *arg )
+{
+	static_cast<drumkv1_jack *> (arg)->setSampleRate(float(nframes));
+
+	return 0;
+}
+
+
 //----------------------------------------------------------------------
 // JACK on-shutdown callback.
 
@@ -183,6 +194,7 @@ drumkv1_jack::drumkv1_jack (const char *client_name) : drumkv1(2)
 #endif
 
 	drumkv1::programs()->enabled(true);
+	drumkv1::programs()->preload();
 	drumkv1::controls()->enabled(true);
 
 	open(client_name);
@@ -366,6 +378,9 @@ void drumkv1_jack::open ( const char *client_name )
 	::jack_set_buffer_size_callback(m_client,
 		drumkv1_jack_buffer_size, this);
 
+	::jack_set_sample_rate_callback(m_client,
+		drumkv1_jack_sample_rate, this);
+
 	::jack_on_shutdown(m_client,
 		drumkv1_jack_on_shutdown, this);
 
@@ -0,0 +1,285 @@
+// drumkv1_kit.cpp
+//
+/****************************************************************************
+   Copyright (C) 2026, rncbc aka Rui Nuno Capela. All rights reserved.
+
+   This program is free software; you can redistribute it and/or
+   modify it under the terms of the GNU General Public License
+   as published by the Free Software Foundation; either version 2
+   of the License, or (at your option) any later version.
+
+   This program is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License along
+   with this program; if not, write to the Free Software Foundation, Inc.,
+   51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+
+*****************************************************************************/
+
+#include "drumkv1_kit.h"
+#include "drumkv1_param.h"
+
+
+//-------------------------------------------------------------------------
+// drumkv1_kit - pre-decoded kit (preset) snapshot.
+//
+
+// element snapshot.
+drumkv1_kit::Element::Element ( int key )
+	: key(key), offsetStart(0), offsetEnd(0), sample(nullptr)
+{
+	for (uint32_t i = 0; i < drumkv1::NUM_ELEMENT_PARAMS; ++i) {
+		const drumkv1::ParamIndex index = drumkv1::ParamIndex(i);
+		params[i] = drumkv1_param::paramDefaultValue(index);
+	}
+
+	params[drumkv1::GEN1_SAMPLE] = float(key);
+}
+
+
+drumkv1_kit::Element::~Element (void)
+{
+	drumkv1_sample::unref(sample);
+}
+
+
+// sample playback setup (reverse, offset mode and range).
+static void drumkv1_kit_offset_range ( const drumkv1_sample *pSample,
+	uint32_t iOffsetStart, uint32_t iOffsetEnd,
+	uint32_t& iStart, uint32_t& iEnd )
+{
+	// offsets are saved as of the untrimmed sample
+	const uint32_t iTrimStart = pSample->trimStart();
+	iStart = (iOffsetStart > iTrimStart ? iOffsetStart - iTrimStart : 0);
+	iEnd = (iOffsetEnd > iTrimStart ? iOffsetEnd - iTrimStart : 0);
+}
+
+
+void drumkv1_kit::Element::setupSample ( drumkv1_sample *pSample ) const
+{
+	pSample->setReverse(params[drumkv1::GEN1_REVERSE] > 0.5f);
+	pSample->setOffset(params[drumkv1::GEN1_OFFSET] > 0.5f);
+
+	uint32_t iStart, iEnd;
+	drumkv1_kit_offset_range(pSample, offsetStart, offsetEnd, iStart, iEnd);
+	pSample->setOffsetRange(iStart, iEnd);
+}
+
+
+bool drumkv1_kit::Element::isSampleSetup ( const drumkv1_sample *pSample ) const
+{
+	const char *pszSampleFile = pSample->filename();
+	if (pszSampleFile == nullptr || sampleFile != pszSampleFile)
+		return false;
+
+	if (pSample->isReverse() != (params[drumkv1::GEN1_REVERSE] > 0.5f))
+		return false;
+	if (pSample->isOffset() != (params[drumkv1::GEN1_OFFSET] > 0.5f))
+		return false;
+
+	// as clamped by drumkv1_sample::setOffsetRange()...
+	const uint32_t nframes = pSample->length();
+	uint32_t iStart, iEnd;
+	drumkv1_kit_offset_range(pSample, offsetStart, offsetEnd, iStart, iEnd);
+	if (iStart > nframes)
+		iStart = nframes;
+	if (iEnd > nframes || iStart >= iEnd)
+		iEnd = nframes;
+	if (iStart >= iEnd) {
+		iStart = 0;
+		iEnd = nframes;
+	}
+
+	return (pSample->offsetStart() == iStart && pSample->offsetEnd() == iEnd);
+}
+
+
+// ctor.
+drumkv1_kit::drumkv1_kit (void)
+	: m_sample_format(-1), m_resample_quality(-1), m_load_quality(-1),
+		m_current_element(-1), m_preload_srate(0.0f),
+		m_preload_format(-1), m_preload_quality(-1)
+{
+	for (uint32_t i = 0; i < drumkv1::NUM_PARAMS; ++i) {
+		m_params[i] = 0.0f;
+		m_params_set[i] = false;
+	}
+}
+
+
+// dtor.
+drumkv1_kit::~drumkv1_kit (void)
+{
+	clear();
+}
+
+
+// element managers
+drumkv1_kit::Element *drumkv1_kit::addElement ( int key )
+{
+	Element *element = new Element(key);
+	m_elements.append(element);
+	return element;
+}
+
+
+void drumkv1_kit::clear (void)
+{
+	qDeleteAll(m_elements);
+	m_elements.clear();
+
+	for (uint32_t i = 0; i < drumkv1::NUM_PARAMS; ++i)
+		m_params_set[i] = false;
+
+	m_sample_format = -1;
+	m_resample_quality = -1;
+	m_load_quality = -1;
+	m_current_element = -1;
+
+	m_tuning = Tuning();
+
+	m_preload_srate = 0.0f;
+	m_preload_format = -1;
+	m_preload_quality = -1;
+}
+
+
+// global parameter values (as of preset).
+void drumkv1_kit::setParamValue ( drumkv1::ParamIndex index, float fValue )
+{
+	m_params[index] = fValue;
+	m_params_set[index] = true;
+}
+
+
+// pre-load all element samples through the cache (non-RT).
+void drumkv1_kit::preload ( drumkv1_sample_cache *pCache, float srate,
+	int iSampleFormat, int iResampleQuality )
+{
+	if (m_sample_format >= 0)
+		iSampleFormat = m_sample_format;
+	if (m_resample_quality >= 0)
+		iResampleQuality = m_resample_quality;
+
+	const drumkv1_sample::Format format
+		= drumkv1_sample::Format(iSampleFormat);
+	const drumkv1_sample::Quality quality
+		= drumkv1_sample::Quality(iResampleQuality);
+
+	QListIterator<Element *> iter(m_elements);
+	while (iter.hasNext()) {
+		Element *element = iter.next();
+		drumkv1_sample *sample
+			= pCache->sample(element, srate, format, quality);
+		drumkv1_sample::unref(element->sample);
+		element->sample = sample;
+	}
+
+	m_preload_srate = srate;
+	m_preload_format = iSampleFormat;
+	m_preload_quality = iResampleQuality;
+}
+
+
+// whether pre-loaded as such (per kit settings override the defaults).
+bool drumkv1_kit::isPreloaded ( float srate,
+	int iSampleFormat, int iResampleQuality ) const
+{
+	if (m_sample_format >= 0)
+		iSampleFormat = m_sample_format;
+	if (m_resample_quality >= 0)
+		iResampleQuality = m_resample_quality;
+
+	return (m_preload_srate == srate
+		&& m_preload_format == iSampleFormat
+		&& m_preload_quality == iResampleQuality);
+}
+
+
+//-------------------------------------------------------------------------
+// drumkv1_sample_cache - shared pre-loaded samples (non-RT).
+//
+
+// ctor.
+drumkv1_sample_cache::drumkv1_sample_cache (void)
+{
+}
+
+
+// dtor.
+drumkv1_sample_cache::~drumkv1_sample_cache (void)
+{
+	clear();
+}
+
+
+// get a new reference to a loaded sample, opening it if missing.
+drumkv1_sample *drumkv1_sample_cache::sample (
+	const drumkv1_kit::Element *pElement, float srate,
+	drumkv1_sample::Format format, drumkv1_sample::Quality quality )
+{
+	const QByteArray& aSampleFile = pElement->sampleFile;
+	if (aSampleFile.isEmpty())
+		return nullptr;
+
+	const QByteArray aKey = aSampleFile
+		+ '|' + QByteArray::number(pElement->key)
+		+ '|' + QByteArray::number(pElement->params[drumkv1::GEN1_REVERSE])
+		+ '|' + QByteArray::number(pElement->params[drumkv1::GEN1_OFFSET])
+		+ '|' + QByteArray::number(pElement->offsetStart)
+		+ '|' + QByteArray::number(pElement->offsetEnd)
+		+ '|' + QByteArray::number(double(srate))
+		+ '|' + QByteArray::number(int(format))
+		+ '|' + QByteArray::number(int(quality));
+
+	drumkv1_sample *sample = m_samples.value(aKey, nullptr);
+	if (sample == nullptr) {
+		sample = new drumkv1_sample(srate);
+		sample->setFormat(format);
+		sample->setQuality(quality);
+		if (!sample->open(aSampleFile.constData())) {
+			delete sample;
+			return nullptr;
+		}
+		pElement->setupSample(sample);
+		m_samples.insert(aKey, sample);
+	}
+
+	sample->ref();
+	return sample;
+}
+
+
+// drop all entries that are not referenced elsewhere.
+void drumkv1_sample_cache::prune (void)
+{
+	QHash<QByteArray, drumkv1_sample *>::Iterator iter = m_samples.begin();
+	while (iter != m_samples.end()) {
+		drumkv1_sample *sample = iter.value();
+		if (!sample->isShared()) {
+			drumkv1_sample::unref(sample);
+			iter = m_samples.erase(iter);
+		}
+		else ++iter;
+	}
+}
+
+
+// drop all entries.
+void drumkv1_sample_cache::clear (void)
+{
+	QHash<QByteArray, drumkv1_sample *>::ConstIterator iter
+		= m_samples.constBegin();
+	const QHash<QByteArray, drumkv1_sample *>::ConstIterator& iter_end
+		= m_samples.constEnd();
+	for ( ; iter != iter_end; ++iter)
+		drumkv1_sample::unref(iter.value());
+
+	m_samples.clear();
+}
+
+
+// end of drumkv1_kit.cpp
@@ -0,0 +1,196 @@
+// drumkv1_kit.h
+//
+/****************************************************************************
+   Copyright (C) 2026, rncbc aka Rui Nuno Capela. All rights reserved.
+
+   This program is free software; you can redistribute it and/or
+   modify it under the terms of the GNU General Public License
+   as published by the Free Software Foundation; either version 2
+   of the License, or (at your option) any later version.
+
+   This program is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License along
+   with this program; if not, write to the Free Software Foundation, Inc.,
+   51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+
+*****************************************************************************/
+
+#ifndef __drumkv1_kit_h
+#define __drumkv1_kit_h
+
+#include "drumkv1.h"
+#include "drumkv1_sample.h"
+
+#include <QByteArray>
+#include <QList>
+#include <QHash>
+
+
+class drumkv1_sample_cache;
+
+
+//-------------------------------------------------------------------------
+// drumkv1_kit - pre-decoded kit (preset) snapshot.
+//
+
+class drumkv1_kit
+{
+public:
+
+	// ctor.
+	drumkv1_kit();
+
+	// dtor.
+	~drumkv1_kit();
+
+	// element snapshot.
+	struct Element
+	{
+		Element(int key);
+		~Element();
+
+		int        key;
+		QByteArray sampleFile;
+		uint32_t   offsetStart;	// as saved (untrimmed)
+		uint32_t   offsetEnd;
+		float      params[drumkv1::NUM_ELEMENT_PARAMS];
+
+		drumkv1_sample *sample;	// pre-loaded (shared), if any.
+
+		// sample playback setup (reverse, offset mode and range).
+		void setupSample(drumkv1_sample *pSample) const;
+		bool isSampleSetup(const drumkv1_sample *pSample) const;
+	};
+
+	typedef QList<Element *> Elements;
+
+	const Elements& elements() const
+		{ return m_elements; }
+
+	// element managers
+	Element *addElement(int key);
+	void clear();
+
+	// global parameter values (as of preset).
+	void setParamValue(drumkv1::ParamIndex index, float fValue);
+	float paramValue(drumkv1::ParamIndex index) const
+		{ return m_params[index]; }
+	bool isParamValue(drumkv1::ParamIndex index) const
+		{ return m_params_set[index]; }
+
+	// per kit sample storage format and resampler quality (-1=default).
+	void setSampleFormat(int iSampleFormat)
+		{ m_sample_format = iSampleFormat; }
+	int sampleFormat() const
+		{ return m_sample_format; }
+
+	void setResampleQuality(int iResampleQuality)
+		{ m_resample_quality = iResampleQuality; }
+	int resampleQuality() const
+		{ return m_resample_quality; }
+
+	// resampler quality for samples loaded anew (-1=same as above),
+	// eg. draft first, upgraded in the background afterwards.
+	void setLoadQuality(int iLoadQuality)
+		{ m_load_quality = iLoadQuality; }
+	int loadQuality() const
+		{ return m_load_quality; }
+
+	// current element key (-1=none).
+	void setCurrentElement(int key)
+		{ m_current_element = key; }
+	int currentElement() const
+		{ return m_current_element; }
+
+	// micro-tuning (as of preset).
+	struct Tuning
+	{
+		Tuning() : valid(false), enabled(false),
+			refPitch(440.0f), refNote(69) {}
+
+		bool       valid;
+		bool       enabled;
+		float      refPitch;
+		int        refNote;
+		QByteArray scaleFile;
+		QByteArray keyMapFile;
+	};
+
+	Tuning& tuning()
+		{ return m_tuning; }
+	const Tuning& tuning() const
+		{ return m_tuning; }
+
+	// pre-load all element samples through the cache (non-RT).
+	void preload(drumkv1_sample_cache *pCache, float srate,
+		int iSampleFormat, int iResampleQuality);
+
+	// whether pre-loaded as such.
+	bool isPreloaded(float srate,
+		int iSampleFormat, int iResampleQuality) const;
+
+private:
+
+	// instance variables.
+	Elements m_elements;
+
+	float m_params[drumkv1::NUM_PARAMS];
+	bool  m_params_set[drumkv1::NUM_PARAMS];
+
+	int m_sample_format;
+	int m_resample_quality;
+	int m_load_quality;
+
+	int m_current_element;
+
+	Tuning m_tuning;
+
+	float m_preload_srate;
+	int   m_preload_format;
+	int   m_preload_quality;
+};
+
+
+//-------------------------------------------------------------------------
+// drumkv1_sample_cache - shared pre-loaded samples (non-RT).
+//
+// Samples are keyed by file, element key and playback setup and the
+// loading sample-rate, storage format and resampler quality, so that
+// shared ones are never changed; the cache holds one reference
+// of its own, so entries may be pruned once nobody else holds them.
+
+class drumkv1_sample_cache
+{
+public:
+
+	// ctor.
+	drumkv1_sample_cache();
+
+	// dtor.
+	~drumkv1_sample_cache();
+
+	// get a new reference to a loaded sample, opening it if missing.
+	drumkv1_sample *sample(const drumkv1_kit::Element *pElement,
+		float srate, drumkv1_sample::Format format,
+		drumkv1_sample::Quality quality);
+
+	// drop all entries that are not referenced elsewhere.
+	void prune();
+
+	// drop all entries.
+	void clear();
+
+private:
+
+	// instance variables.
+	QHash<QByteArray, drumkv1_sample *> m_samples;
+};
+
+
+#endif	// __drumkv1_kit_h
+
+// end of drumkv1_kit.h
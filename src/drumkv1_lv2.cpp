@@ -444,8 +444,13 @@ void drumkv1_lv2::run ( uint32_t nframes )
 							) && type == m_urids.atom_Int) {
 							drumkv1_sample *pSample = drumkv1::sample();
 							if (pSample) {
-								const uint32_t offset_start
+								// as of the untrimmed sample (cf. presets).
+								const uint32_t trim_start
+									= pSample->trimStart();
+								uint32_t offset_start
 									= *(int32_t *) LV2_ATOM_BODY_CONST(value);
+								offset_start = (offset_start > trim_start
+									? offset_start - trim_start : 0);
 								const uint32_t offset_end
 									= pSample->offsetEnd();
 								setOffsetRange(offset_start, offset_end, true);
@@ -459,10 +464,15 @@ void drumkv1_lv2::run ( uint32_t nframes )
 							) && type == m_urids.atom_Int) {
 							drumkv1_sample *pSample = drumkv1::sample();
 							if (pSample) {
+								// as of the untrimmed sample (cf. presets).
+								const uint32_t trim_start
+									= pSample->trimStart();
 								const uint32_t offset_start
 									= pSample->offsetStart();
-								const uint32_t offset_end
+								uint32_t offset_end
 									= *(int32_t *) LV2_ATOM_BODY_CONST(value);
+								offset_end = (offset_end > trim_start
+									? offset_end - trim_start : 0);
 								setOffsetRange(offset_start, offset_end, true);
 							}
 						}
@@ -991,11 +1001,16 @@ bool drumkv1_lv2::patch_set ( LV2_URID key )
 		lv2_atom_forge_path(&m_forge, pszSampleFile, ::strlen(pszSampleFile) + 1);
 	}
 	else
-	if (key == m_urids.p102_offset_start)
-		lv2_atom_forge_int(&m_forge, (pSample ? pSample->offsetStart() : 0));
+	if (key == m_urids.p102_offset_start) {
+		// as of the untrimmed sample (cf. presets).
+		lv2_atom_forge_int(&m_forge, (pSample
+			? pSample->offsetStart() + pSample->trimStart() : 0));
+	}
 	else
-	if (key == m_urids.p103_offset_end)
-		lv2_atom_forge_int(&m_forge, (pSample ? pSample->offsetEnd() : 0));
+	if (key == m_urids.p103_offset_end) {
+		lv2_atom_forge_int(&m_forge, (pSample
+			? pSample->offsetEnd() + pSample->trimStart() : 0));
+	}
 	else
 	if (key == m_urids.p201_tuning_enabled)
 		lv2_atom_forge_bool(&m_forge, drumkv1::isTuningEnabled());
@@ -0,0 +1,211 @@
+// drumkv1_mlock.cpp
+//
+/****************************************************************************
+   Copyright (C) 2024, rncbc aka Rui Nuno Capela. All rights reserved.
+
+   This program is free software; you can redistribute it and/or
+   modify it under the terms of the GNU General Public License
+   as published by the Free Software Foundation; either version 2
+   of the License, or (at your option) any later version.
+
+   This program is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License along
+   with this program; if not, write to the Free Software Foundation, Inc.,
+   51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+
+*****************************************************************************/
+
+#include "drumkv1_mlock.h"
+
+#include <QMutex>
+#include <QHash>
+
+#if defined(__unix__) || defined(__APPLE__)
+#include <sys/mman.h>
+#include <sys/resource.h>
+#include <unistd.h>
+#endif
+
+
+//-------------------------------------------------------------------------
+// drumkv1_mlock - prefault and lock (wire) memory ranges (non-RT).
+//
+
+static bool g_mlock_enabled   = false;
+static bool g_mlock_hugepages = false;
+
+static size_t g_mlock_locked = 0;
+
+static QMutex g_mlock_mutex;
+static QHash<const void *, size_t> g_mlock_ranges;
+
+// locked pages (page number) reference count, as ranges
+// may share their ragged end pages with one another.
+static QHash<uintptr_t, uint32_t> g_mlock_pages;
+
+
+// system page size.
+static size_t mlock_page_size (void)
+{
+#if defined(__unix__) || defined(__APPLE__)
+	static const long s_page_size = ::sysconf(_SC_PAGESIZE);
+	if (s_page_size > 0)
+		return size_t(s_page_size);
+#endif
+	return 4096;
+}
+
+
+// locked memory limit (bytes, 0=unlimited).
+static size_t mlock_limit (void)
+{
+#if defined(__unix__) || defined(__APPLE__)
+	struct rlimit rlim;
+	if (::getrlimit(RLIMIT_MEMLOCK, &rlim) == 0
+		&& rlim.rlim_cur != RLIM_INFINITY)
+		return size_t(rlim.rlim_cur);
+#endif
+	return 0;
+}
+
+
+// unlock a whole run of pages (page numbers, [p0, p1)).
+static void mlock_munlock ( uintptr_t p0, uintptr_t p1 )
+{
+	if (p0 >= p1)
+		return;
+#if defined(__unix__) || defined(__APPLE__)
+	const size_t npage = mlock_page_size();
+	::munlock(reinterpret_cast<void *> (p0 * npage), (p1 - p0) * npage);
+#endif
+}
+
+
+// touch each page (read-write) so it gets mapped in beforehand.
+static void mlock_prefault ( const void *addr, size_t nbytes )
+{
+	const size_t npage = mlock_page_size();
+	volatile uint8_t *p = static_cast<volatile uint8_t *> (
+		const_cast<void *> (addr));
+	for (size_t i = 0; i < nbytes; i += npage)
+		p[i] = p[i];
+	if (nbytes > 0)
+		p[nbytes - 1] = p[nbytes - 1];
+}
+
+
+void drumkv1_mlock::setEnabled ( bool enabled, bool hugepages )
+{
+	QMutexLocker locker(&g_mlock_mutex);
+
+	g_mlock_enabled = enabled;
+	g_mlock_hugepages = hugepages;
+}
+
+
+bool drumkv1_mlock::isEnabled (void)
+{
+	return g_mlock_enabled;
+}
+
+
+bool drumkv1_mlock::lock ( const void *addr, size_t nbytes )
+{
+	if (addr == nullptr || nbytes < 1)
+		return false;
+
+	QMutexLocker locker(&g_mlock_mutex);
+
+	if (!g_mlock_enabled)
+		return false;
+
+#if defined(__linux__) && defined(MADV_HUGEPAGE)
+	// transparent huge-pages hint, only worth it on large ranges
+	// and only effective before the pages are first touched.
+	const size_t nhuge = 2 * 1024 * 1024;
+	if (g_mlock_hugepages && nbytes >= nhuge) {
+		const uintptr_t p0 = reinterpret_cast<uintptr_t> (addr);
+		const uintptr_t p1 = (p0 + nhuge - 1) & ~uintptr_t(nhuge - 1);
+		const uintptr_t p2 = (p0 + nbytes) & ~uintptr_t(nhuge - 1);
+		if (p2 > p1)
+			::madvise(reinterpret_cast<void *> (p1), p2 - p1, MADV_HUGEPAGE);
+	}
+#endif
+
+	mlock_prefault(addr, nbytes);
+
+	if (g_mlock_ranges.contains(addr))
+		return true;
+
+#if defined(__unix__) || defined(__APPLE__)
+	// whole pages get locked, some of which may be already...
+	const size_t npage = mlock_page_size();
+	const uintptr_t p0 = reinterpret_cast<uintptr_t> (addr) / npage;
+	const uintptr_t p1 = (reinterpret_cast<uintptr_t> (addr)
+		+ nbytes + npage - 1) / npage;
+	size_t nlocks = 0;
+	for (uintptr_t p = p0; p < p1; ++p) {
+		if (!g_mlock_pages.contains(p))
+			nlocks += npage;
+	}
+	const size_t nlimit = mlock_limit();
+	if (nlimit > 0 && g_mlock_locked + nlocks > nlimit)
+		return false;
+	if (::mlock(reinterpret_cast<void *> (p0 * npage), (p1 - p0) * npage) != 0)
+		return false;
+	for (uintptr_t p = p0; p < p1; ++p)
+		++g_mlock_pages[p];
+	g_mlock_ranges.insert(addr, nbytes);
+	g_mlock_locked += nlocks;
+	return true;
+#else
+	return false;
+#endif
+}
+
+
+void drumkv1_mlock::unlock ( const void *addr )
+{
+	if (addr == nullptr)
+		return;
+
+	QMutexLocker locker(&g_mlock_mutex);
+
+	if (!g_mlock_ranges.contains(addr))
+		return;
+
+	const size_t nbytes = g_mlock_ranges.take(addr);
+
+	// unlock only those pages no other range is still holding...
+	const size_t npage = mlock_page_size();
+	const uintptr_t p0 = reinterpret_cast<uintptr_t> (addr) / npage;
+	const uintptr_t p1 = (reinterpret_cast<uintptr_t> (addr)
+		+ nbytes + npage - 1) / npage;
+	uintptr_t q0 = p0;
+	for (uintptr_t p = p0; p < p1; ++p) {
+		QHash<uintptr_t, uint32_t>::Iterator iter = g_mlock_pages.find(p);
+		if (iter == g_mlock_pages.end() || --iter.value() > 0) {
+			mlock_munlock(q0, p);
+			q0 = p + 1;
+			continue;
+		}
+		g_mlock_pages.erase(iter);
+		g_mlock_locked -= npage;
+	}
+	mlock_munlock(q0, p1);
+}
+
+
+size_t drumkv1_mlock::locked (void)
+{
+	QMutexLocker locker(&g_mlock_mutex);
+
+	return g_mlock_locked;
+}
+
+
+// end of drumkv1_mlock.cpp
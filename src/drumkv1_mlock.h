@@ -0,0 +1,60 @@
+// drumkv1_mlock.h
+//
+/****************************************************************************
+   Copyright (C) 2024, rncbc aka Rui Nuno Capela. All rights reserved.
+
+   This program is free software; you can redistribute it and/or
+   modify it under the terms of the GNU General Public License
+   as published by the Free Software Foundation; either version 2
+   of the License, or (at your option) any later version.
+
+   This program is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License along
+   with this program; if not, write to the Free Software Foundation, Inc.,
+   51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+
+*****************************************************************************/
+
+#ifndef __drumkv1_mlock_h
+#define __drumkv1_mlock_h
+
+#include <cstdint>
+#include <cstddef>
+
+
+//-------------------------------------------------------------------------
+// drumkv1_mlock - prefault and lock (wire) memory ranges (non-RT).
+//
+// Ranges are locked only while enabled and within RLIMIT_MEMLOCK;
+// otherwise they're just prefaulted (touched). Unlocking a range
+// that was never locked is a harmless no-op. Locking is done on
+// whole pages, reference counted, as ranges may share some. The
+// huge-pages hint is only effective on pages not touched yet, so
+// better lock right after allocation, before filling in.
+
+class drumkv1_mlock
+{
+public:
+
+	// enable/disable memory locking (and transparent huge-pages hint).
+	static void setEnabled(bool enabled, bool hugepages = false);
+	static bool isEnabled();
+
+	// prefault and lock a memory range.
+	static bool lock(const void *addr, size_t nbytes);
+
+	// unlock a previously locked memory range.
+	static void unlock(const void *addr);
+
+	// total locked memory (bytes, whole pages).
+	static size_t locked();
+};
+
+
+#endif	// __drumkv1_mlock_h
+
+// end of drumkv1_mlock.h
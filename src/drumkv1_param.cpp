@@ -21,6 +21,7 @@
 
 #include "drumkv1_param.h"
 #include "drumkv1_config.h"
+#include "drumkv1_kit.h"
 
 #include "drumkv1_sched.h"
 
@@ -224,96 +225,39 @@ void drumkv1_param::loadElements (
 	if (pDrumk == nullptr)
 		return;
 
-	pDrumk->clearElements();
-
-	static QHash<QString, drumkv1::ParamIndex> s_hash;
-	if (s_hash.isEmpty()) {
-		for (uint32_t i = 0; i < drumkv1::NUM_ELEMENT_PARAMS; ++i)
-			s_hash.insert(drumkv1_params[i].name, drumkv1::ParamIndex(i));
+	// Sample storage format (per kit)...
+	int iSampleFormat = 0;
+	if (eElements.hasAttribute("sample-format")) {
+		iSampleFormat = eElements.attribute("sample-format").toInt();
+	} else {
+		drumkv1_config *pConfig = drumkv1_config::getInstance();
+		if (pConfig)
+			iSampleFormat = pConfig->iSampleFormat;
 	}
-
-	for (QDomNode nElement = eElements.firstChild();
-			!nElement.isNull();
-				nElement = nElement.nextSibling()) {
-		QDomElement eElement = nElement.toElement();
-		if (eElement.isNull())
-			continue;
-		if (eElement.tagName() == "element") {
-			const int note = eElement.attribute("index").toInt();
-			drumkv1_element *element = pDrumk->addElement(note);
-			for (uint32_t i = 0; i < drumkv1::NUM_ELEMENT_PARAMS; ++i) {
-				const drumkv1::ParamIndex index = drumkv1::ParamIndex(i);
-				const float fDefValue = paramDefaultValue(index);
-				element->setParamValue(index, fDefValue, 0);
-				element->setParamValue(index, fDefValue);
-			}
-			for (QDomNode nChild = eElement.firstChild();
-					!nChild.isNull();
-						nChild = nChild.nextSibling()) {
-				QDomElement eChild = nChild.toElement();
-				if (eChild.isNull())
-					continue;
-				if (eChild.tagName() == "sample") {
-				//	const int index = eChild.attribute("index").toInt();
-					const uint32_t iOffsetStart
-						= eChild.attribute("offset-start").toULong();
-					const uint32_t iOffsetEnd
-						= eChild.attribute("offset-end").toULong();
-					const QString& sSampleFile
-						= eChild.text();
-					const QByteArray aSampleFile
-						= mapPath.absolutePath(
-							drumkv1_param::loadFilename(sSampleFile)).toUtf8();
-					element->setSampleFile(aSampleFile.constData());
-					element->setOffsetRange(iOffsetStart, iOffsetEnd);
-				}
-				else
-				if (eChild.tagName() == "params") {
-					for (QDomNode nParam = eChild.firstChild();
-							!nParam.isNull();
-								nParam = nParam.nextSibling()) {
-						QDomElement eParam = nParam.toElement();
-						if (eParam.isNull())
-							continue;
-						if (eParam.tagName() == "param") {
-							drumkv1::ParamIndex index = drumkv1::ParamIndex(
-								eParam.attribute("index").toULong());
-							const QString& sName = eParam.attribute("name");
-							if (!sName.isEmpty() && s_hash.contains(sName))
-								index = s_hash.value(sName);
-							if (index == drumkv1::GEN1_OFFSET_1 ||
-								index == drumkv1::GEN1_OFFSET_2)
-								continue;
-							const float fValue
-								= drumkv1_param::paramSafeValue(index,
-									eParam.text().toFloat());
-							element->setParamValue(index, fValue, 0);
-							element->setParamValue(index, fValue);
-						}
-					}
-				}
-			}
-		#if 0//DRUMKV1_LV2_LEGACY_2
-			// Load/correct functional dependent parametrics...
-			const bool bOffset
-				= element->isOffset();
-			const uint32_t iSampleLength
-				= element->length();
-			const uint32_t iOffsetStart
-				= element->offsetStart();
-			const uint32_t iOffsetEnd
-				= element->offsetEnd();
-			const float fOffset_1 = (bOffset && iSampleLength > 0
-				? float(iOffsetStart) / float(iSampleLength) : 0.0f);
-			const float fOffset_2 = (bOffset && iSampleLength > 0
-				? float(iOffsetEnd) / float(iSampleLength) : 1.0f);
-			element->setParamValue(drumkv1::GEN1_OFFSET_1, fOffset_1, 0);
-			element->setParamValue(drumkv1::GEN1_OFFSET_1, fOffset_1);
-			element->setParamValue(drumkv1::GEN1_OFFSET_2, fOffset_2, 0);
-			element->setParamValue(drumkv1::GEN1_OFFSET_2, fOffset_2);
-		#endif
-		}
+	pDrumk->setSampleFormat(iSampleFormat);
+
+	// Resampler quality profile (per kit),
+	// possibly loading as draft first...
+	int iResampleQuality = 1;
+	bool bResampleProgressive = false;
+	drumkv1_config *pConfig = drumkv1_config::getInstance();
+	if (pConfig) {
+		iResampleQuality = pConfig->iResampleQuality;
+		bResampleProgressive = pConfig->bResampleProgressive;
 	}
+	if (eElements.hasAttribute("resample-quality"))
+		iResampleQuality = eElements.attribute("resample-quality").toInt();
+
+	// Decode and apply as a diff against the current elements,
+	// keeping all samples that are still the same as loaded...
+	drumkv1_kit kit;
+	drumkv1_param::loadKitElements(&kit, eElements, mapPath);
+	if (bResampleProgressive && iResampleQuality > 0)
+		kit.setLoadQuality(0);
+	pDrumk->updateElements(&kit);
+
+	// Final quality, upgrading in the background...
+	pDrumk->setResampleQuality(iResampleQuality);
 }
 
 
@@ -324,6 +268,9 @@ void drumkv1_param::saveElements (
 	if (pDrumk == nullptr)
 		return;
 
+	eElements.setAttribute("sample-format", pDrumk->sampleFormat());
+	eElements.setAttribute("resample-quality", pDrumk->resampleQuality());
+
 	for (int note = 0; note < 128; ++note) {
 		drumkv1_element *element = pDrumk->element(note);
 		if (element == nullptr)
@@ -338,8 +285,9 @@ void drumkv1_param::saveElements (
 		eSample.setAttribute("index", 0);
 		eSample.setAttribute("name", "GEN1_SAMPLE");
 		if (element->isOffset()) {
-			eSample.setAttribute("offset-start", element->offsetStart());
-			eSample.setAttribute("offset-end", element->offsetEnd());
+			const uint32_t iTrimStart = element->trimStart();
+			eSample.setAttribute("offset-start", element->offsetStart() + iTrimStart);
+			eSample.setAttribute("offset-end", element->offsetEnd() + iTrimStart);
 		}
 		eSample.appendChild(doc.createTextNode(mapPath.abstractPath(
 			drumkv1_param::saveFilename(
@@ -370,31 +318,26 @@ bool drumkv1_param::newPreset ( drumkv1 *pDrumk )
 	if (pDrumk == nullptr)
 		return false;
 
-	const bool running = pDrumk->running(false);
+	drumkv1_sched::sync_reset(pDrumk);
 
-	drumkv1_sched::sync_reset();
+	// Swap in an empty element set,
+	// old voices still playing on the old one...
+	drumkv1_kit kit;
+	pDrumk->updateElements(&kit);
 
 	pDrumk->stabilize();
-	pDrumk->reset();
-
-	pDrumk->clearElements();
 
-	drumkv1_sched::sync_pending();
-
-	pDrumk->running(running);
+	drumkv1_sched::sync_pending(pDrumk);
 
 	return true;
 }
 
 
-// Preset serialization methods.
-bool drumkv1_param::loadPreset (
-	drumkv1 *pDrumk, const QString& sFilename )
+// Preset file lookup (possibly by name, as of config).
+static bool drumkv1_param_preset_file (
+	const QString& sFilename, QFileInfo& fi )
 {
-	if (pDrumk == nullptr)
-		return false;
-
-	QFileInfo fi(sFilename);
+	fi.setFile(sFilename);
 	if (!fi.exists()) {
 		drumkv1_config *pConfig = drumkv1_config::getInstance();
 		if (pConfig) {
@@ -408,18 +351,64 @@ bool drumkv1_param::loadPreset (
 		}
 	}
 
-	QFile file(fi.filePath());
-	if (!file.open(QIODevice::ReadOnly))
+	return true;
+}
+
+
+// Preset serialization methods.
+bool drumkv1_param::loadPreset (
+	drumkv1 *pDrumk, const QString& sFilename )
+{
+	if (pDrumk == nullptr)
 		return false;
 
-	const bool running = pDrumk->running(false);
+	// Decode it all first, while still running...
+	drumkv1_kit kit;
+	if (!drumkv1_param::loadKit(&kit, sFilename))
+		return false;
+
+	drumkv1_sched::sync_reset(pDrumk);
+
+	// Resampler quality profile (per kit),
+	// possibly loading as draft first...
+	int iResampleQuality = kit.resampleQuality();
+	bool bResampleProgressive = false;
+	drumkv1_config *pConfig = drumkv1_config::getInstance();
+	if (pConfig) {
+		if (iResampleQuality < 0)
+			iResampleQuality = pConfig->iResampleQuality;
+		bResampleProgressive = pConfig->bResampleProgressive;
+	}
+	if (bResampleProgressive && iResampleQuality > 0)
+		kit.setLoadQuality(0);
+
+	// Build and swap in the whole new element set, old voices
+	// still playing on the old one; draft samples get upgraded
+	// to the final quality in the background, as swapped in...
+	pDrumk->applyKit(&kit);
+
+	drumkv1_sched::sync_pending(pDrumk);
+
+	return true;
+}
 
-	drumkv1_sched::sync_reset();
 
-	pDrumk->setTuningEnabled(false);
-	pDrumk->reset();
+// Kit snapshot (pre-decoding) methods.
+bool drumkv1_param::loadKit (
+	drumkv1_kit *pKit, const QString& sFilename )
+{
+	if (pKit == nullptr)
+		return false;
 
-	pDrumk->clearElements();
+	QFileInfo fi;
+	if (!drumkv1_param_preset_file(sFilename, fi))
+		return false;
+
+	QFile file(fi.filePath());
+	if (!file.open(QIODevice::ReadOnly))
+		return false;
+
+	pKit->clear();
 
 	static QHash<QString, drumkv1::ParamIndex> s_hash;
 	if (s_hash.isEmpty()) {
@@ -435,13 +424,10 @@ bool drumkv1_param::loadPreset (
 	const QDir currentDir(QDir::current());
 	QDir::setCurrent(fi.absolutePath());
 
-	int iCurrentElement = -1;
-
 	QDomDocument doc(PROJECT_NAME);
 	if (doc.setContent(&file)) {
 		QDomElement ePreset = doc.documentElement();
 		if (ePreset.tagName() == "preset") {
-		//	&& ePreset.attribute("name") == fi.completeBaseName()) {
 			for (QDomNode nChild = ePreset.firstChild();
 					!nChild.isNull();
 						nChild = nChild.nextSibling()) {
@@ -464,23 +450,25 @@ bool drumkv1_param::loadPreset (
 									continue;
 								index = s_hash.value(sName);
 							}
+							if (index >= drumkv1::NUM_PARAMS)
+								continue;
 							const float fValue = eParam.text().toFloat();
-							pDrumk->setParamValue(index,
+							pKit->setParamValue(index,
 								drumkv1_param::paramSafeValue(index, fValue));
 						}
 					}
 				}
 				else
 				if (eChild.tagName() == "elements") {
-					drumkv1_param::loadElements(pDrumk, eChild);
+					drumkv1_param::loadKitElements(pKit, eChild);
 				}
 				else
 				if (eChild.tagName() == "current-element") {
-					iCurrentElement = eChild.text().toInt();
+					pKit->setCurrentElement(eChild.text().toInt());
 				}
 				else
 				if (eChild.tagName() == "tuning") {
-					drumkv1_param::loadTuning(pDrumk, eChild);
+					drumkv1_param::loadKitTuning(pKit, eChild);
 				}
 			}
 		}
@@ -488,19 +476,126 @@ bool drumkv1_param::loadPreset (
 
 	file.close();
 
-	pDrumk->stabilize();
-	pDrumk->reset();
+	QDir::setCurrent(currentDir.absolutePath());
 
-	if (iCurrentElement >= 0)
-		pDrumk->setCurrentElement(iCurrentElement);
+	return true;
+}
 
-	drumkv1_sched::sync_pending();
 
-	pDrumk->running(running);
+void drumkv1_param::loadKitElements (
+	drumkv1_kit *pKit, const QDomElement& eElements,
+	const drumkv1_param::map_path& mapPath )
+{
+	if (pKit == nullptr)
+		return;
 
-	QDir::setCurrent(currentDir.absolutePath());
+	if (eElements.hasAttribute("sample-format"))
+		pKit->setSampleFormat(eElements.attribute("sample-format").toInt());
+	if (eElements.hasAttribute("resample-quality"))
+		pKit->setResampleQuality(eElements.attribute("resample-quality").toInt());
 
-	return true;
+	static QHash<QString, drumkv1::ParamIndex> s_hash;
+	if (s_hash.isEmpty()) {
+		for (uint32_t i = 0; i < drumkv1::NUM_ELEMENT_PARAMS; ++i)
+			s_hash.insert(drumkv1_params[i].name, drumkv1::ParamIndex(i));
+	}
+
+	for (QDomNode nElement = eElements.firstChild();
+			!nElement.isNull();
+				nElement = nElement.nextSibling()) {
+		QDomElement eElement = nElement.toElement();
+		if (eElement.isNull())
+			continue;
+		if (eElement.tagName() == "element") {
+			const int note = eElement.attribute("index").toInt();
+			drumkv1_kit::Element *element = pKit->addElement(note);
+			for (QDomNode nChild = eElement.firstChild();
+					!nChild.isNull();
+						nChild = nChild.nextSibling()) {
+				QDomElement eChild = nChild.toElement();
+				if (eChild.isNull())
+					continue;
+				if (eChild.tagName() == "sample") {
+					element->offsetStart
+						= eChild.attribute("offset-start").toULong();
+					element->offsetEnd
+						= eChild.attribute("offset-end").toULong();
+					const QString& sSampleFile
+						= eChild.text();
+					element->sampleFile
+						= mapPath.absolutePath(
+							drumkv1_param::loadFilename(sSampleFile)).toUtf8();
+				}
+				else
+				if (eChild.tagName() == "params") {
+					for (QDomNode nParam = eChild.firstChild();
+							!nParam.isNull();
+								nParam = nParam.nextSibling()) {
+						QDomElement eParam = nParam.toElement();
+						if (eParam.isNull())
+							continue;
+						if (eParam.tagName() == "param") {
+							drumkv1::ParamIndex index = drumkv1::ParamIndex(
+								eParam.attribute("index").toULong());
+							const QString& sName = eParam.attribute("name");
+							if (!sName.isEmpty() && s_hash.contains(sName))
+								index = s_hash.value(sName);
+							if (index >= drumkv1::NUM_ELEMENT_PARAMS ||
+								index == drumkv1::GEN1_SAMPLE ||
+								index == drumkv1::GEN1_OFFSET_1 ||
+								index == drumkv1::GEN1_OFFSET_2)
+								continue;
+							element->params[index]
+								= drumkv1_param::paramSafeValue(index,
+									eParam.text().toFloat());
+						}
+					}
+				}
+			}
+		}
+	}
+}
+
+
+void drumkv1_param::loadKitTuning (
+	drumkv1_kit *pKit, const QDomElement& eTuning )
+{
+	if (pKit == nullptr)
+		return;
+
+	drumkv1_kit::Tuning& tuning = pKit->tuning();
+
+	tuning.valid = true;
+	tuning.enabled = (eTuning.attribute("enabled").toInt() > 0);
+
+	for (QDomNode nChild = eTuning.firstChild();
+			!nChild.isNull();
+				nChild = nChild.nextSibling()) {
+		QDomElement eChild = nChild.toElement();
+		if (eChild.isNull())
+			continue;
+		if (eChild.tagName() == "enabled") {
+			tuning.enabled = (eChild.text().toInt() > 0);
+		}
+		else
+		if (eChild.tagName() == "ref-pitch") {
+			tuning.refPitch = eChild.text().toFloat();
+		}
+		else
+		if (eChild.tagName() == "ref-note") {
+			tuning.refNote = eChild.text().toInt();
+		}
+		else
+		if (eChild.tagName() == "scale-file") {
+			tuning.scaleFile = QDir::current().absoluteFilePath(
+				drumkv1_param::loadFilename(eChild.text())).toUtf8();
+		}
+		else
+		if (eChild.tagName() == "keymap-file") {
+			tuning.keyMapFile = QDir::current().absoluteFilePath(
+				drumkv1_param::loadFilename(eChild.text())).toUtf8();
+		}
+	}
 }
 
 
@@ -30,6 +30,8 @@
 class QDomElement;
 class QDomDocument;
 
+class drumkv1_kit;
+
 
 //-------------------------------------------------------------------------
 // drumkv1_param - decl.
@@ -65,6 +67,15 @@ namespace drumkv1_param
 		const map_path& mapPath = map_path(),
 		bool bSymLink = false);
 
+	// Kit snapshot (pre-decoding) methods.
+	bool loadKit(drumkv1_kit *pKit,
+		const QString& sFilename);
+	void loadKitElements(drumkv1_kit *pKit,
+		const QDomElement& eElements,
+		const map_path& mapPath = map_path());
+	void loadKitTuning(drumkv1_kit *pKit,
+		const QDomElement& eTuning);
+
 	// Tuning serialization methods.
 	void loadTuning(drumkv1 *pDrumk,
 		const QDomElement& eTuning);
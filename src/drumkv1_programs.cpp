@@ -28,9 +28,11 @@
 
 // ctor.
 drumkv1_programs::drumkv1_programs ( drumkv1 *pDrumk )
-	: m_enabled(false), m_sched(pDrumk),
+	: m_enabled(false), m_crossfade(true),
+		m_sched(pDrumk), m_preload(pDrumk),
 		m_bank_msb(0), m_bank_lsb(0),
-		m_bank(nullptr), m_prog(nullptr)
+		m_bank(nullptr), m_prog(nullptr),
+		m_preloaded(false)
 {
 }
 
@@ -39,6 +41,9 @@ drumkv1_programs::drumkv1_programs ( drumkv1 *pDrumk )
 drumkv1_programs::~drumkv1_programs (void)
 {
 	clear_banks();
+
+	qDeleteAll(m_kits);
+	m_kits.clear();
 }
 
 
@@ -180,11 +185,96 @@ void drumkv1_programs::process_program (
 	m_bank = find_bank(bank_id);
 	m_prog = (m_bank ? m_bank->find_prog(prog_id) : nullptr);
 
-	if (m_prog) {
+	if (m_prog == nullptr)
+		return;
+
+	// pre-decoded and pre-loaded already?
+	drumkv1_kit *pKit = m_kits.value(m_prog->name(), nullptr);
+	if (pKit && pKit->isPreloaded(pDrumk->sampleRate(),
+			pDrumk->sampleFormat(), pDrumk->resampleQuality()))
+		pDrumk->applyKit(pKit, m_crossfade);
+	else
 		drumkv1_param::loadPreset(pDrumk, m_prog->name());
-		pDrumk->updateSample();
-		pDrumk->updateParams();
+
+	pDrumk->updateSample();
+	pDrumk->updateParams();
+
+	// resume pre-loading, if left behind...
+	if (!m_preloaded)
+		preload();
+}
+
+
+// pre-load all programs (kit snapshots), in the background.
+void drumkv1_programs::preload (void)
+{
+	if (!enabled())
+		return;
+
+	m_preload.schedule();
+}
+
+
+void drumkv1_programs::process_preload ( drumkv1 *pDrumk )
+{
+	m_preloaded = false;
+
+	// as of the instance's current settings...
+	const float srate = pDrumk->sampleRate();
+	const int iSampleFormat = pDrumk->sampleFormat();
+	const int iResampleQuality = pDrumk->resampleQuality();
+
+	// all distinct program presets, as of now...
+	QStringList names;
+	Banks::ConstIterator bank_iter = m_banks.constBegin();
+	const Banks::ConstIterator& bank_end = m_banks.constEnd();
+	for ( ; bank_iter != bank_end; ++bank_iter) {
+		const Progs& progs = bank_iter.value()->progs();
+		Progs::ConstIterator prog_iter = progs.constBegin();
+		const Progs::ConstIterator& prog_end = progs.constEnd();
+		for ( ; prog_iter != prog_end; ++prog_iter) {
+			const QString& sName = prog_iter.value()->name();
+			if (!names.contains(sName))
+				names.append(sName);
+		}
+	}
+
+	// drop stale kits (gone or as of another sample-rate, format or quality)...
+	QHash<QString, drumkv1_kit *>::Iterator iter = m_kits.begin();
+	while (iter != m_kits.end()) {
+		drumkv1_kit *pKit = iter.value();
+		if (!names.contains(iter.key())
+			|| (pKit && !pKit->isPreloaded(srate,
+				iSampleFormat, iResampleQuality))) {
+			delete pKit;
+			iter = m_kits.erase(iter);
+		}
+		else ++iter;
 	}
+
+	// pre-decode and pre-load the next missing one, a program per run,
+	// so that anything else (eg. program changes) gets serviced between...
+	QStringListIterator name_iter(names);
+	while (name_iter.hasNext()) {
+		const QString& sName = name_iter.next();
+		if (m_kits.contains(sName))
+			continue;
+		drumkv1_kit *pKit = new drumkv1_kit();
+		if (drumkv1_param::loadKit(pKit, sName)) {
+			pKit->preload(&m_cache, srate, iSampleFormat, iResampleQuality);
+		} else {
+			delete pKit;
+			pKit = nullptr; // failed, don't retry.
+		}
+		m_kits.insert(sName, pKit);
+		m_preload.schedule();
+		return;
+	}
+
+	// drop samples no longer in use...
+	m_cache.prune();
+
+	m_preloaded = true;
 }
 
 
@@ -24,6 +24,7 @@
 
 #include "drumkv1_sched.h"
 #include "drumkv1_param.h"
+#include "drumkv1_kit.h"
 
 #include <QMap>
 
@@ -48,6 +49,12 @@ public:
 	bool enabled() const
 		{ return m_enabled; }
 
+	// crossfade ringing voices on program change.
+	void crossfade(bool on)
+		{ m_crossfade = on; }
+	bool crossfade() const
+		{ return m_crossfade; }
+
 	// prog. base node
 	class Prog
 	{
@@ -113,6 +120,11 @@ public:
 
 	void process_program(drumkv1 *pDrumk, uint16_t bank_id, uint16_t prog_id);
 
+	// pre-load all programs (kit snapshots), in the background.
+	void preload();
+
+	void process_preload(drumkv1 *pDrumk);
+
 	Bank *current_bank() const { return m_bank; }
 	Prog *current_prog() const { return m_prog; }
 
@@ -155,13 +167,34 @@ protected:
 		uint16_t m_prog_id;
 	};
 
+	// programs pre-loading scheduled thread
+	class PreloadSched : public drumkv1_sched
+	{
+	public:
+
+		// ctor.
+		PreloadSched (drumkv1 *pDrumk)
+			: drumkv1_sched(pDrumk, Preload) {}
+
+		// process (virtual).
+		void process(int)
+		{
+			drumkv1 *pDrumk = instance();
+			drumkv1_programs *pPrograms = pDrumk->programs();
+			pPrograms->process_preload(pDrumk);
+		}
+	};
+
 private:
 
 	// instance variables.
 	bool m_enabled;
+	bool m_crossfade;
 
 	Sched m_sched;
 
+	PreloadSched m_preload;
+
 	uint8_t m_bank_msb;
 	uint8_t m_bank_lsb;
 
@@ -169,6 +202,14 @@ private:
 	Prog *m_prog;
 
 	Banks m_banks;
+
+	// pre-decoded kits, per program preset name,
+	// and their pre-loaded samples (worker thread only).
+	QHash<QString, drumkv1_kit *> m_kits;
+
+	drumkv1_sample_cache m_cache;
+
+	bool m_preloaded;
 };
 
 
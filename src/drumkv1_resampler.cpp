@@ -22,11 +22,18 @@
 
 #include "drumkv1_resampler.h"
 
+#include "drumkv1_mlock.h"
+
 #include <cstdlib>
 #include <cstring>
 
 #include <cmath>
 
+#if defined(__x86_64__) && defined(__GNUC__)
+#include <immintrin.h>
+#define DRUMKV1_RESAMPLER_SIMD
+#endif
+
 
 // ----------------------------------------------------------------------------
 // drumkv1_resampler
@@ -64,6 +71,7 @@ drumkv1_resampler::Table::Table (
 	float *ptab;
 
 	ctab = new float [hl * (np + 1)];
+	drumkv1_mlock::lock(ctab, hl * (np + 1) * sizeof(float));
 	ptab = ctab;
 	for (j = 0; j <= np; ++j) {
 		t = float(j) / float(np);
@@ -78,6 +86,7 @@ drumkv1_resampler::Table::Table (
 
 drumkv1_resampler::Table::~Table (void)
 {
+	drumkv1_mlock::unlock(ctab);
 	delete [] ctab;
 }
 
@@ -85,57 +94,76 @@ drumkv1_resampler::Table::~Table (void)
 drumkv1_resampler::Table *drumkv1_resampler::Table::create (
 	float fr0, unsigned int hl0, unsigned int np0 )
 {
-	Table *p;
+	Table *p, *q, *t = nullptr;
 
 	g_mutex.lock();
 
-	p = g_list;
-
-	while (p) {
-		if ((fr0 >= p->fr * 0.999f) &&
-			(fr0 <= p->fr * 1.001f) &&
-			(hl0 == p->hl) && (np0 == p->np)) {
-			p->refc++;
-			g_mutex.unlock();
-			return p;
+	for (;;) {
+		p = g_list;
+		q = nullptr;
+		while (p) {
+			if ((fr0 >= p->fr * 0.999f) &&
+				(fr0 <= p->fr * 1.001f) &&
+				(hl0 == p->hl) && (np0 == p->np)) {
+				// move to front (most recently used)...
+				if (q) {
+					q->next = p->next;
+					p->next = g_list;
+					g_list  = p;
+				}
+				p->refc++;
+				g_mutex.unlock();
+				if (t)
+					delete t;
+				return p;
+			}
+			q = p;
+			p = p->next;
 		}
-		p = p->next;
+		if (t)
+			break;
+		// compute a new table outside the lock,
+		// then look it up again, just in case...
+		g_mutex.unlock();
+		t = new drumkv1_resampler::Table(fr0, hl0, np0);
+		g_mutex.lock();
 	}
 
-	p = new drumkv1_resampler::Table(fr0, hl0, np0);
-	p->refc = 1;
-	p->next = g_list;
-	g_list  = p;
+	t->refc = 1;
+	t->next = g_list;
+	g_list  = t;
 
 	g_mutex.unlock();
 
-	return p;
+	return t;
 }
 
 
 void drumkv1_resampler::Table::destroy ( drumkv1_resampler::Table *table )
 {
 	Table *p, *q;
+	unsigned int n;
 
 	g_mutex.lock();
 
-	if (table) {
-		table->refc--;
-		if (table->refc == 0) {
-			p = g_list;
-			q = nullptr;
-			while (p) {
-				if (p == table) {
-					if (q)
-						q->next = table->next;
-					else
-						g_list = table->next;
-					break;
-				}
-				q = p;
-				p = p->next;
+	// unreferenced tables are kept cached for reuse (most
+	// recently used first), only the oldest ones get pruned.
+	if (table && table->refc > 0 && --table->refc == 0) {
+		n = 0;
+		p = g_list;
+		q = nullptr;
+		while (p) {
+			if (p->refc == 0 && ++n > MAX_CACHED) {
+				if (q)
+					q->next = p->next;
+				else
+					g_list = p->next;
+				delete p;
+				p = (q ? q->next : g_list);
+				continue;
 			}
-			delete table;
+			q = p;
+			p = p->next;
 		}
 	}
 
@@ -168,8 +196,206 @@ static unsigned int gcd ( unsigned int a, unsigned int b )
 }
 
 
+// ----------------------------------------------------------------------------
+// drumkv1_resampler - polyphase filter kernels.
+//
+// q1 is the first (oldest) input frame of the forward half, q2 is one
+// past the last frame of the backward half, both channel interleaved;
+// c1 and c2 are the filter rows of the current phase and its mirror.
+
+static void filter_c (
+	const float *q1, const float *q2, const float *c1, const float *c2,
+	unsigned int hl, unsigned int nchan, float *out )
+{
+	for (unsigned int c = 0; c < nchan; ++c) {
+		const float *r1 = q1 + c;
+		const float *r2 = q2 + c;
+		float s = 1e-20f;
+		for (unsigned int i = 0; i < hl; ++i) {
+			r2 -= nchan;
+			s += *r1 * c1[i] + *r2 * c2[i];
+			r1 += nchan;
+		}
+		out[c] = s - 1e-20f;
+	}
+}
+
+
+#ifdef DRUMKV1_RESAMPLER_SIMD
+
+// The backward half is walked forward instead, from its oldest
+// frame (b2 = q2 - hl * nchan), with the mirror row reversed in
+// registers, so that all loads are plain contiguous ones.
+
+static void filter_sse (
+	const float *q1, const float *q2, const float *c1, const float *c2,
+	unsigned int hl, unsigned int nchan, float *out )
+{
+	unsigned int i = 0;
+
+	if (nchan == 1) {
+		const float *b2 = q2 - hl;
+		__m128 s1 = _mm_setzero_ps();
+		__m128 s2 = _mm_setzero_ps();
+		for ( ; i + 4 <= hl; i += 4) {
+			__m128 k2 = _mm_loadu_ps(c2 + hl - 4 - i);
+			k2 = _mm_shuffle_ps(k2, k2, _MM_SHUFFLE(0, 1, 2, 3));
+			s1 = _mm_add_ps(s1, _mm_mul_ps(_mm_loadu_ps(q1 + i), _mm_loadu_ps(c1 + i)));
+			s2 = _mm_add_ps(s2, _mm_mul_ps(_mm_loadu_ps(b2 + i), k2));
+		}
+		s1 = _mm_add_ps(s1, s2);
+		s1 = _mm_add_ps(s1, _mm_movehl_ps(s1, s1));
+		s1 = _mm_add_ss(s1, _mm_shuffle_ps(s1, s1, _MM_SHUFFLE(1, 1, 1, 1)));
+		float s = _mm_cvtss_f32(s1);
+		for ( ; i < hl; ++i)
+			s += q1[i] * c1[i] + b2[i] * c2[hl - 1 - i];
+		out[0] = s;
+	}
+	else
+	if (nchan == 2) {
+		const float *b2 = q2 - 2 * hl;
+		__m128 s1 = _mm_setzero_ps();
+		__m128 s2 = _mm_setzero_ps();
+		for ( ; i + 4 <= hl; i += 4) {
+			const __m128 k1 = _mm_loadu_ps(c1 + i);
+			__m128 k2 = _mm_loadu_ps(c2 + hl - 4 - i);
+			k2 = _mm_shuffle_ps(k2, k2, _MM_SHUFFLE(0, 1, 2, 3));
+			const float *r1 = q1 + 2 * i;
+			const float *r2 = b2 + 2 * i;
+			s1 = _mm_add_ps(s1, _mm_mul_ps(_mm_loadu_ps(r1 + 0), _mm_unpacklo_ps(k1, k1)));
+			s1 = _mm_add_ps(s1, _mm_mul_ps(_mm_loadu_ps(r1 + 4), _mm_unpackhi_ps(k1, k1)));
+			s2 = _mm_add_ps(s2, _mm_mul_ps(_mm_loadu_ps(r2 + 0), _mm_unpacklo_ps(k2, k2)));
+			s2 = _mm_add_ps(s2, _mm_mul_ps(_mm_loadu_ps(r2 + 4), _mm_unpackhi_ps(k2, k2)));
+		}
+		s1 = _mm_add_ps(s1, s2);
+		s1 = _mm_add_ps(s1, _mm_movehl_ps(s1, s1));
+		float s[4];
+		_mm_storeu_ps(s, s1);
+		for ( ; i < hl; ++i) {
+			const float k1 = c1[i];
+			const float k2 = c2[hl - 1 - i];
+			s[0] += q1[2 * i + 0] * k1 + b2[2 * i + 0] * k2;
+			s[1] += q1[2 * i + 1] * k1 + b2[2 * i + 1] * k2;
+		}
+		out[0] = s[0];
+		out[1] = s[1];
+	}
+	else filter_c(q1, q2, c1, c2, hl, nchan, out);
+}
+
+
+__attribute__((target("avx2,fma")))
+static void filter_avx2 (
+	const float *q1, const float *q2, const float *c1, const float *c2,
+	unsigned int hl, unsigned int nchan, float *out )
+{
+	unsigned int i = 0;
+
+	if (nchan == 1) {
+		const __m256i rev = _mm256_setr_epi32(7, 6, 5, 4, 3, 2, 1, 0);
+		const float *b2 = q2 - hl;
+		__m256 s1 = _mm256_setzero_ps();
+		__m256 s2 = _mm256_setzero_ps();
+		for ( ; i + 8 <= hl; i += 8) {
+			const __m256 k2 = _mm256_permutevar8x32_ps(
+				_mm256_loadu_ps(c2 + hl - 8 - i), rev);
+			s1 = _mm256_fmadd_ps(_mm256_loadu_ps(q1 + i), _mm256_loadu_ps(c1 + i), s1);
+			s2 = _mm256_fmadd_ps(_mm256_loadu_ps(b2 + i), k2, s2);
+		}
+		s1 = _mm256_add_ps(s1, s2);
+		__m128 s0 = _mm_add_ps(_mm256_castps256_ps128(s1), _mm256_extractf128_ps(s1, 1));
+		s0 = _mm_add_ps(s0, _mm_movehl_ps(s0, s0));
+		s0 = _mm_add_ss(s0, _mm_shuffle_ps(s0, s0, _MM_SHUFFLE(1, 1, 1, 1)));
+		float s = _mm_cvtss_f32(s0);
+		for ( ; i < hl; ++i)
+			s += q1[i] * c1[i] + b2[i] * c2[hl - 1 - i];
+		out[0] = s;
+	}
+	else
+	if (nchan == 2) {
+		const __m256i dup = _mm256_setr_epi32(0, 0, 1, 1, 2, 2, 3, 3);
+		const __m256i rev = _mm256_setr_epi32(3, 3, 2, 2, 1, 1, 0, 0);
+		const float *b2 = q2 - 2 * hl;
+		__m256 s1 = _mm256_setzero_ps();
+		__m256 s2 = _mm256_setzero_ps();
+		for ( ; i + 4 <= hl; i += 4) {
+			const __m256 k1 = _mm256_permutevar8x32_ps(
+				_mm256_castps128_ps256(_mm_loadu_ps(c1 + i)), dup);
+			const __m256 k2 = _mm256_permutevar8x32_ps(
+				_mm256_castps128_ps256(_mm_loadu_ps(c2 + hl - 4 - i)), rev);
+			s1 = _mm256_fmadd_ps(_mm256_loadu_ps(q1 + 2 * i), k1, s1);
+			s2 = _mm256_fmadd_ps(_mm256_loadu_ps(b2 + 2 * i), k2, s2);
+		}
+		s1 = _mm256_add_ps(s1, s2);
+		__m128 s0 = _mm_add_ps(_mm256_castps256_ps128(s1), _mm256_extractf128_ps(s1, 1));
+		s0 = _mm_add_ps(s0, _mm_movehl_ps(s0, s0));
+		float s[4];
+		_mm_storeu_ps(s, s0);
+		for ( ; i < hl; ++i) {
+			const float k1 = c1[i];
+			const float k2 = c2[hl - 1 - i];
+			s[0] += q1[2 * i + 0] * k1 + b2[2 * i + 0] * k2;
+			s[1] += q1[2 * i + 1] * k1 + b2[2 * i + 1] * k2;
+		}
+		out[0] = s[0];
+		out[1] = s[1];
+	}
+	else filter_c(q1, q2, c1, c2, hl, nchan, out);
+}
+
+#endif	// DRUMKV1_RESAMPLER_SIMD
+
+
+#ifdef DRUMKV1_RESAMPLER_SIMD
+
+static bool has_avx2 (void)
+{
+	static const bool s_avx2
+		= __builtin_cpu_supports("avx2") && __builtin_cpu_supports("fma");
+	return s_avx2;
+}
+
+#endif	// DRUMKV1_RESAMPLER_SIMD
+
+
+// polyphase kernel override.
+drumkv1_resampler::Kernel drumkv1_resampler::g_kernel = drumkv1_resampler::Auto;
+
+bool drumkv1_resampler::setKernel ( Kernel kernel )
+{
+#ifdef DRUMKV1_RESAMPLER_SIMD
+	if (kernel == AVX2 && !has_avx2())
+		return false;
+#else
+	if (kernel == SSE || kernel == AVX2)
+		return false;
+#endif
+	g_kernel = kernel;
+	return true;
+}
+
+
+// best kernel for the running CPU (runtime dispatch).
+drumkv1_resampler::Filter drumkv1_resampler::filter ( unsigned int nchan )
+{
+#ifdef DRUMKV1_RESAMPLER_SIMD
+	if ((nchan == 1 || nchan == 2) && g_kernel != Scalar) {
+		if (g_kernel == SSE)
+			return filter_sse;
+		return (has_avx2() ? filter_avx2 : filter_sse);
+	}
+#else
+	(void) nchan;
+#endif
+	return filter_c;
+}
+
+
+// ----------------------------------------------------------------------------
+// drumkv1_resampler
+
 drumkv1_resampler::drumkv1_resampler (void)
-	: m_table(nullptr), m_nchan(0), m_buff(nullptr)
+	: m_filter(filter_c), m_table(nullptr), m_nchan(0), m_buff(nullptr)
 {
 	reset();
 }
@@ -224,6 +450,7 @@ bool drumkv1_resampler::setup (
 	clear();
 
 	if (table) {
+		m_filter = filter(nchan);
 		m_table = table;
 		m_buff  = buff;
 		m_nchan = nchan;
@@ -296,7 +523,7 @@ bool drumkv1_resampler::reset (void)
 
 bool drumkv1_resampler::process (void)
 {
-	unsigned int hl, ph, np, dp, in, nr, nz, i, n, c;
+	unsigned int hl, ph, np, dp, in, nr, nz, n, c;
 	float *p1, *p2;
 
 	if (m_table == nullptr)
@@ -334,19 +561,10 @@ bool drumkv1_resampler::process (void)
 		} else {
 			if (out_data) {
 				if (nz < 2 * hl) {
-					float *c1 = m_table->ctab + hl * ph;
-					float *c2 = m_table->ctab + hl * (np - ph);
-					for (c = 0; c < m_nchan; ++c) {
-						float *q1 = p1 + c;
-						float *q2 = p2 + c;
-						float s = 1e-20f;
-						for (i = 0; i < hl; ++i) {
-							q2 -= m_nchan;
-							s += *q1 * c1[i] + *q2 * c2[i];
-							q1 += m_nchan;
-						}
-						*out_data++ = s - 1e-20f;
-					}
+					const float *c1 = m_table->ctab + hl * ph;
+					const float *c2 = m_table->ctab + hl * (np - ph);
+					(*m_filter)(p1, p2, c1, c2, hl, m_nchan, out_data);
+					out_data += m_nchan;
 				} else {
 					for (c = 0; c < m_nchan; ++c)
 						*out_data++ = 0.0f;
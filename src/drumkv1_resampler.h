@@ -86,14 +86,33 @@ public:
 		static Table *create(float fr0, unsigned int hl0, unsigned int np0);
 		static void destroy(Table *table);
 
+		// max. unreferenced tables kept cached.
+		static const unsigned int MAX_CACHED = 16;
+
 	private:
 
 		static Table *g_list;
 		static Mutex  g_mutex;
 	};
 
+	// polyphase kernel override (benchmarking only);
+	// effective on next setup(), false if not available.
+	enum Kernel { Auto = 0, Scalar, SSE, AVX2 };
+
+	static bool setKernel(Kernel kernel);
+
 private:
 
+	// polyphase filter kernel (one output frame, all channels).
+	typedef void (*Filter)(const float *q1, const float *q2,
+		const float *c1, const float *c2,
+		unsigned int hl, unsigned int nchan, float *out);
+
+	static Filter filter(unsigned int nchan);
+
+	static Kernel g_kernel;
+
+	Filter        m_filter;
 	Table        *m_table;
 	unsigned int  m_nchan;
 	unsigned int  m_inmax;
@@ -25,6 +25,8 @@
 #include <cstdint>
 #include <cstring>
 
+#include "drumkv1_mlock.h"
+
 
 //-------------------------------------------------------------------------
 // drumkv1_reverb
@@ -171,7 +173,7 @@ protected:
 			{ resize(size); }
 
 		virtual ~sample_buffer()
-			{ delete [] m_buffer; }
+			{ drumkv1_mlock::unlock(m_buffer); delete [] m_buffer; }
 
 		void reset()
 			{ ::memset(m_buffer, 0, m_size * sizeof(float)); m_index = 0; }
@@ -186,9 +188,11 @@ protected:
 					float *old_buffer = m_buffer;
 					m_buffer = new float [size];
 					m_size = size;
+					drumkv1_mlock::lock(m_buffer, size * sizeof(float));
 					if (old_buffer) {
 						::memcpy(m_buffer, old_buffer,
 							old_size * sizeof(float));
+						drumkv1_mlock::unlock(old_buffer);
 						delete [] old_buffer;
 					}
 				}
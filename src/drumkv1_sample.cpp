@@ -23,8 +23,26 @@
 
 #include "drumkv1_resampler.h"
 
+#include "drumkv1_mlock.h"
+
 #include <sndfile.h>
 
+#include <cmath>
+
+
+// frame block alignment (cache-line), also the guard size
+// (in bytes) on both ends of each channel, wide enough for
+// vectorized kernels in either playback direction.
+const uint32_t ALIGN_BYTES = 64;
+
+// silence trimming threshold (linear, 0=off).
+static float g_silence_threshold = 0.0f;
+
+// compressed format quantization (24-bit, lossy for float sources)
+// and Rice escape.
+const int32_t  PACKED_SCALE  = 0x800000;
+const uint32_t PACKED_ESCAPE = 24;
+
 
 //-------------------------------------------------------------------------
 // drumkv1_sample - sampler wave table.
@@ -34,10 +52,20 @@
 drumkv1_sample::drumkv1_sample ( float srate )
 	: m_srate(srate), m_filename(nullptr), m_nchannels(0),
 		m_rate0(0.0f), m_freq0(1.0f), m_ratio(0.0f),
-		m_nframes(0), m_pframes(nullptr), m_reverse(false),
+		m_nframes(0), m_pframes(nullptr), m_reverse(false), m_trim_start(0),
+		m_format(Float32), m_fscale(1.0f), m_quality(Medium),
+		m_nzcross(0), m_zcross(nullptr), m_zslope(nullptr),
+		m_nlevels(0), m_level_req(0),
+		m_source_rate(0.0f),
+		m_peaks(nullptr), m_npeak_levels(0),
 		m_offset(false), m_offset_start(0), m_offset_end(0),
-		m_offset_phase0(0.0f), m_offset_end2(0)
+		m_offset_phase0(0.0f), m_offset_end2(0), m_nrefs(1)
 {
+	for (uint16_t level = 0; level < MAX_LEVELS; ++level) {
+		m_plevels[level] = nullptr;
+		m_pblocks[level] = nullptr;
+		m_nlevels_frames[level] = 0;
+	}
 }
 
 
@@ -47,6 +75,17 @@ drumkv1_sample::drumkv1_sample ( const drumkv1_sample& sample )
 {
 	m_offset  = sample.m_offset;
 	m_reverse = sample.m_reverse;
+	m_format  = sample.m_format;
+	m_quality = sample.m_quality;
+
+	// same file and offsets, kept on re-open (see open()).
+	if (sample.m_filename)
+		m_filename = ::strdup(sample.m_filename);
+
+	m_offset_start = sample.m_offset_start;
+	m_offset_end   = sample.m_offset_end;
+
+	m_level_req.store(sample.m_level_req.load());
 }
 
 
@@ -75,29 +114,120 @@ bool drumkv1_sample::open ( const char *filename, float freq0 )
 
 	m_filename = filename2;
 
+	uint32_t nframes = 0;
+	float *source = read(nframes);
+	if (source == nullptr)
+		return false;
+
+	const bool ret = build(source, nframes, freq0);
+
+	delete [] source;
+
+	return ret;
+}
+
+
+// read source data from file (non-RT).
+float *drumkv1_sample::read ( uint32_t& nframes )
+{
 	SF_INFO info;
 	::memset(&info, 0, sizeof(info));
-	
+
 	SNDFILE *file = ::sf_open(m_filename, SFM_READ, &info);
 	if (file == nullptr)
-		return false;
+		return nullptr;
 
 	m_nchannels = info.channels;
-	m_rate0     = float(info.samplerate);
-	m_nframes   = info.frames;
+	m_source_rate = float(info.samplerate);
+
+	nframes = info.frames;
+	float *source = new float [m_nchannels * nframes];
+
+	const int nread = ::sf_readf_float(file, source, nframes);
+	if (nread > 0)
+		nframes = uint32_t(nread);
+	else
+		nframes = 0;
+
+	::sf_close(file);
+
+	return source;
+}
 
-	float *buffer = new float [m_nchannels * m_nframes];
 
-	const int nread = ::sf_readf_float(file, buffer, m_nframes);
-	if (nread > 0) {
+// resampler filter size (taps) per quality profile.
+uint32_t drumkv1_sample::qualityTaps ( Quality quality )
+{
+	switch (quality) {
+	case Draft:
+		return 16;
+	case High:
+		return 48;
+	case Best:
+		return 64;
+	case Medium:
+	default:
+		return 32;
+	}
+}
+
+
+// re-resample from another sample file (non-RT).
+bool drumkv1_sample::resample ( const drumkv1_sample *sample )
+{
+	close();
+
+	if (sample->m_filename == nullptr)
+		return false;
+
+	m_filename = ::strdup(sample->m_filename);
+
+	// re-read the source data, as it's not kept around...
+	uint32_t nframes = 0;
+	float *source = read(nframes);
+	if (source == nullptr)
+		return false;
+
+	const bool ret = build(source, nframes, sample->m_freq0);
+
+	delete [] source;
+
+	if (!ret)
+		return false;
+
+	// rescale offsets (on untrimmed frames)...
+	if (sample->m_nframes > 0 && sample->m_srate > 0.0f) {
+		const float r = m_srate / sample->m_srate;
+		uint32_t start = uint32_t(r * float(
+			sample->m_offset_start + sample->m_trim_start));
+		uint32_t end = uint32_t(r * float(
+			sample->m_offset_end + sample->m_trim_start));
+		start = (start > m_trim_start ? start - m_trim_start : 0);
+		end = (end > m_trim_start ? end - m_trim_start : 0);
+		setOffsetRange(start, end);
+	}
+
+	return true;
+}
+
+
+// resample, trim and store from source data.
+bool drumkv1_sample::build ( float *source, uint32_t nframes, float freq0 )
+{
+	m_rate0   = m_source_rate;
+	m_nframes = nframes;
+
+	float *buffer = source;
+
+	if (m_nframes > 0) {
 		// resample start...
-		const uint32_t ninp = uint32_t(nread);
+		const uint32_t ninp = m_nframes;
 		const uint32_t rinp = uint32_t(m_rate0);
 		const uint32_t rout = uint32_t(m_srate);
 		if (rinp != rout) {
 			drumkv1_resampler resampler;
 			const uint32_t nout = uint32_t(float(ninp) * m_srate / m_rate0);
-			const uint32_t FILTSIZE = 32; // resample medium quality
+			const uint32_t FILTSIZE = qualityTaps(m_quality);
 			if (resampler.setup(rinp, rout, m_nchannels, FILTSIZE)) {
 				float *inpb = buffer;
 				float *outb = new float [m_nchannels * nout];
@@ -107,7 +237,6 @@ bool drumkv1_sample::open ( const char *filename, float freq0 )
 				resampler.out_data  = outb;
 				resampler.process();
 				buffer = outb;
-				delete [] inpb;
 				// identical rates now...
 				m_rate0 = float(rout);
 				m_nframes = (nout - resampler.out_count);
@@ -117,46 +246,135 @@ bool drumkv1_sample::open ( const char *filename, float freq0 )
 		// resample end.
 	}
 
-	const uint32_t nsize = m_nframes + 4;
-	m_pframes = new float * [m_nchannels];
-	for (uint16_t k = 0; k < m_nchannels; ++k) {
-		m_pframes[k] = new float [nsize];
-		::memset(m_pframes[k], 0, nsize * sizeof(float));
+	// trim leading/trailing silence...
+	const float *frames = buffer;
+	const float threshold = g_silence_threshold;
+	if (threshold > 0.0f && m_nframes > 0) {
+		uint32_t start = 0;
+		uint32_t end = m_nframes;
+		while (start < end) {
+			const float *v = buffer + start * m_nchannels;
+			uint16_t k = 0;
+			for ( ; k < m_nchannels; ++k) {
+				if (::fabsf(v[k]) > threshold)
+					break;
+			}
+			if (k < m_nchannels)
+				break;
+			++start;
+		}
+		while (end > start) {
+			const float *v = buffer + (end - 1) * m_nchannels;
+			uint16_t k = 0;
+			for ( ; k < m_nchannels; ++k) {
+				if (::fabsf(v[k]) > threshold)
+					break;
+			}
+			if (k < m_nchannels)
+				break;
+			--end;
+		}
+		frames += start * m_nchannels;
+		m_trim_start = start;
+		m_nframes = end - start;
+	}
+
+	// storage scale (full int16 range on peak;
+	// 24-bit steps for compressed, unless over full-scale)...
+	const Format format = levelFormat(0);
+	m_fscale = 1.0f;
+	if (format == Int16 || format == Compressed) {
+		float vmax = 0.0f;
+		const uint32_t nsize = m_nchannels * m_nframes;
+		for (uint32_t i = 0; i < nsize; ++i) {
+			const float v = ::fabsf(frames[i]);
+			if (vmax < v)
+				vmax = v;
+		}
+		if (format == Compressed)
+			m_fscale = (vmax > 1.0f ? vmax : 1.0f) / PACKED_SCALE;
+		else
+		if (vmax > 0.0f)
+			m_fscale = vmax / 32767.0f;
 	}
 
-	uint32_t i = 0;
-	for (uint32_t j = 0; j < m_nframes; ++j) {
+	if (format == Compressed) {
+		m_pframes = new void * [m_nchannels];
 		for (uint16_t k = 0; k < m_nchannels; ++k)
-			m_pframes[k][j] = buffer[i++];
+			m_pframes[k] = pack(frames, k);
+	} else {
+		m_pframes = frames_alloc(format, m_nframes, &m_pblocks[0]);
+		uint32_t i = 0;
+		for (uint32_t j = 0; j < m_nframes; ++j) {
+			for (uint16_t k = 0; k < m_nchannels; ++k)
+				frame_store(format, m_pframes[k], j, frames[i++]);
+		}
 	}
 
-	delete [] buffer;
-	::sf_close(file);
+	peaks_build(frames);
 
-	if (m_reverse)
-		reverse_sync();
+	zero_crossing_index(frames);
+
+	if (buffer != source)
+		delete [] buffer;
+
+	m_plevels[0] = m_pframes;
+	m_nlevels_frames[0] = m_nframes;
+	m_nlevels.store(1, std::memory_order_release);
 
 	reset(freq0);
 
 	updateOffset();
+
+	// rebuild previously requested levels...
+	updateLevels();
+
 	return true;
 }
 
 
 void drumkv1_sample::close (void)
 {
+	const uint16_t nlevels = m_nlevels.load();
+	for (uint16_t level = 1; level < nlevels; ++level)
+		frames_free(levelFormat(level), m_plevels[level], m_pblocks[level]);
+
 	if (m_pframes) {
-		for (uint16_t k = 0; k < m_nchannels; ++k)
-			delete [] m_pframes[k];
-		delete [] m_pframes;
+		frames_free(levelFormat(0), m_pframes, m_pblocks[0]);
 		m_pframes = nullptr;
 	}
 
+	for (uint16_t level = 0; level < MAX_LEVELS; ++level) {
+		m_plevels[level] = nullptr;
+		m_pblocks[level] = nullptr;
+		m_nlevels_frames[level] = 0;
+	}
+
+	m_nlevels.store(0);
+
+	if (m_zcross) {
+		delete [] m_zcross;
+		m_zcross = nullptr;
+	}
+
+	if (m_zslope) {
+		delete [] m_zslope;
+		m_zslope = nullptr;
+	}
+
+	m_nzcross = 0;
+
+	peaks_free();
+
+	m_source_rate = 0.0f;
+
 	m_nframes   = 0;
+	m_trim_start = 0;
 	m_ratio     = 0.0f;
 	m_freq0     = 1.0f;
 	m_rate0     = 0.0f;
 	m_nchannels = 0;
+	m_fscale    = 1.0f;
 
 //	setOffsetRange(0, 0);
 
@@ -167,25 +385,6 @@ void drumkv1_sample::close (void)
 }
 
 
-// reverse sample buffer.
-void drumkv1_sample::reverse_sync (void)
-{
-	if (m_nframes > 0 && m_pframes) {
-		const uint32_t nsize1 = (m_nframes - 1);
-		const uint32_t nsize2 = (m_nframes >> 1);
-		for (uint16_t k = 0; k < m_nchannels; ++k) {
-			float *frames = m_pframes[k];
-			for (uint32_t i = 0; i < nsize2; ++i) {
-				const uint32_t j = nsize1 - i;
-				const float sample = frames[i];
-				frames[i] = frames[j];
-				frames[j] = sample;
-			}
-		}
-	}
-}
-
-
 // offset range.
 void drumkv1_sample::setOffsetRange ( uint32_t start, uint32_t end )
 {
@@ -220,35 +419,676 @@ void drumkv1_sample::updateOffset (void)
 }
 
 
+// zero-crossing index slopes: -1, +1, or 0 for a pair of digital
+// silence (either way); a silent run keeps its first pair as such
+// and its last one as marked below, the pairs in between implied.
+static const int8_t c_zrun_end = 2;
+
+
 // zero-crossing aliasing (all channels).
 uint32_t drumkv1_sample::zero_crossing ( uint32_t i, int *slope ) const
 {
 	const int s0 = (slope ? *slope : 0);
 
-	if (i > 0) --i;
-	float v0 = zero_crossing_k(i);
-	for (++i; i < m_nframes; ++i) {
-		const float v1 = zero_crossing_k(i);
-		if ((0 >= s0 && v0 >= 0.0f && 0.0f >= v1) ||
-			(s0 >= 0 && v1 >= 0.0f && 0.0f >= v0)) {
-			if (slope && s0 == 0) *slope = (v1 < v0 ? -1 : +1);
+	if (i < 1) i = 1;
+
+	// binary search on the (natural order) index;
+	// reverse crossings map as (m_nframes - zcross).
+	uint32_t lo = 0;
+	uint32_t hi = m_nzcross;
+	if (m_reverse) {
+		const uint32_t i2 = (i < m_nframes ? m_nframes - i : 0);
+		while (lo < hi) {
+			const uint32_t mid = (lo + hi) >> 1;
+			if (m_zcross[mid] > i2)
+				hi = mid;
+			else
+				lo = mid + 1;
+		}
+		// within a silent run, right here...
+		if (lo < m_nzcross && m_zslope[lo] == c_zrun_end) {
+			if (slope && s0 == 0) *slope = +1;
 			return i;
 		}
-		v0 = v1;
+		while (lo > 0) {
+			const int z1 = int(m_zslope[--lo]);
+			const int s1 = (z1 == c_zrun_end ? 0 : -z1);
+			if (s0 == 0 || s1 == 0 || s0 == s1) {
+				if (slope && s0 == 0) *slope = (s1 ? s1 : +1);
+				return m_nframes - m_zcross[lo];
+			}
+		}
+	} else {
+		while (lo < hi) {
+			const uint32_t mid = (lo + hi) >> 1;
+			if (m_zcross[mid] < i)
+				lo = mid + 1;
+			else
+				hi = mid;
+		}
+		// within a silent run, right here...
+		if (lo < m_nzcross && m_zcross[lo] > i && m_zslope[lo] == c_zrun_end) {
+			if (slope && s0 == 0) *slope = +1;
+			return i;
+		}
+		for ( ; lo < m_nzcross; ++lo) {
+			const int z1 = int(m_zslope[lo]);
+			const int s1 = (z1 == c_zrun_end ? 0 : z1);
+			if (s0 == 0 || s1 == 0 || s0 == s1) {
+				if (slope && s0 == 0) *slope = (s1 ? s1 : +1);
+				return m_zcross[lo];
+			}
+		}
 	}
 
 	return m_nframes;
 }
 
 
-// zero-crossing aliasing (median).
-float drumkv1_sample::zero_crossing_k ( uint32_t i ) const
+// zero-crossing aliasing (median, natural order, interleaved).
+float drumkv1_sample::zero_crossing_k ( const float *frames, uint32_t i ) const
 {
 	float sum = 0.0f;
+	frames += i * m_nchannels;
 	for (uint16_t k = 0; k < m_nchannels; ++k)
-		sum += m_pframes[k][i];
+		sum += frames[k];
 	return (sum / float(m_nchannels));
 }
 
 
+// zero-crossing index builder (sorted positions and slopes),
+// from the (trimmed) interleaved frames, before these get stored.
+void drumkv1_sample::zero_crossing_index ( const float *frames )
+{
+	if (m_nframes < 2 || frames == nullptr)
+		return;
+
+	const uint32_t n = zero_crossing_scan(frames, nullptr, nullptr);
+	if (n < 1)
+		return;
+
+	m_zcross = new uint32_t [n];
+	m_zslope = new int8_t [n];
+
+	m_nzcross = zero_crossing_scan(frames, m_zcross, m_zslope);
+}
+
+
+// zero-crossing index scan (count only, if no arrays given).
+uint32_t drumkv1_sample::zero_crossing_scan ( const float *frames,
+	uint32_t *zcross, int8_t *zslope ) const
+{
+	uint32_t n = 0;
+	uint32_t zrun0 = 0;
+	uint32_t zrun1 = 0;
+	float v0 = zero_crossing_k(frames, 0);
+	for (uint32_t i = 1; i <= m_nframes; ++i) {
+		const bool last = (i >= m_nframes);
+		const float v1 = (last ? 1.0f : zero_crossing_k(frames, i));
+		if (!last && v0 == 0.0f && v1 == 0.0f) {
+			if (zrun0 == 0) {
+				if (zcross) {
+					zcross[n] = i;
+					zslope[n] = 0;
+				}
+				++n;
+				zrun0 = i;
+			}
+			zrun1 = i;
+			v0 = v1;
+			continue;
+		}
+		// silent run over...
+		if (zrun1 > zrun0) {
+			if (zcross) {
+				zcross[n] = zrun1;
+				zslope[n] = c_zrun_end;
+			}
+			++n;
+		}
+		zrun0 = zrun1 = 0;
+		if (last)
+			break;
+		if ((v0 >= 0.0f && 0.0f >= v1) || (v1 >= 0.0f && 0.0f >= v0)) {
+			if (zcross) {
+				zcross[n] = i;
+				zslope[n] = (v1 < v0 ? -1 : +1);
+			}
+			++n;
+		}
+		v0 = v1;
+	}
+
+	return n;
+}
+
+
+// silence trimming threshold (static).
+void drumkv1_sample::setSilenceThreshold ( float threshold )
+{
+	g_silence_threshold = threshold;
+}
+
+
+float drumkv1_sample::silenceThreshold (void)
+{
+	return g_silence_threshold;
+}
+
+
+// octave levels request (RT-safe).
+bool drumkv1_sample::requestLevel ( float freq )
+{
+	const uint16_t level = drumkv1_sample::level(freq);
+	if (level < levels() || level <= m_level_req.load())
+		return false;
+
+	m_level_req.store(level);
+	return true;
+}
+
+
+// octave levels builder (non-RT).
+void drumkv1_sample::updateLevels (void)
+{
+	uint16_t nlevels = m_nlevels.load();
+	if (nlevels < 1)
+		return;
+
+	const uint16_t level_req = m_level_req.load();
+	while (nlevels <= level_req && nlevels < MAX_LEVELS) {
+		const uint32_t nframes = m_nlevels_frames[nlevels - 1];
+		if (nframes < 2)
+			break;
+		m_plevels[nlevels] = level_decimate(nlevels, &m_pblocks[nlevels]);
+		m_nlevels_frames[nlevels] = ((nframes + 1) >> 1);
+		m_nlevels.store(++nlevels, std::memory_order_release);
+	}
+}
+
+
+// waveform peak pyramid builder (min/max pairs per bucket, all levels).
+void drumkv1_sample::peaks_build ( const float *frames )
+{
+	peaks_free();
+
+	uint32_t nsize = 0;
+	uint32_t nbuckets = (m_nframes + PEAK_BLOCK - 1) / PEAK_BLOCK;
+	while (nbuckets > 0 && m_npeak_levels < MAX_PEAK_LEVELS) {
+		m_peak_offsets[m_npeak_levels] = nsize;
+		m_peak_buckets[m_npeak_levels] = nbuckets;
+		++m_npeak_levels;
+		nsize += nbuckets;
+		if (nbuckets < 2)
+			break;
+		nbuckets = (nbuckets + 1) >> 1;
+	}
+
+	if (nsize < 1 || m_nchannels < 1)
+		return;
+
+	m_peaks = new float * [m_nchannels];
+	for (uint16_t k = 0; k < m_nchannels; ++k) {
+		float *peaks = new float [nsize << 1];
+		// base level, from frames...
+		for (uint32_t b = 0; b < m_peak_buckets[0]; ++b) {
+			const uint32_t i0 = b * PEAK_BLOCK;
+			uint32_t i1 = i0 + PEAK_BLOCK;
+			if (i1 > m_nframes)
+				i1 = m_nframes;
+			float vmin = frames[i0 * m_nchannels + k];
+			float vmax = vmin;
+			for (uint32_t i = i0 + 1; i < i1; ++i) {
+				const float v = frames[i * m_nchannels + k];
+				if (vmin > v)
+					vmin = v;
+				if (vmax < v)
+					vmax = v;
+			}
+			peaks[(b << 1) + 0] = vmin;
+			peaks[(b << 1) + 1] = vmax;
+		}
+		// upper levels, from each level below...
+		for (uint16_t level = 1; level < m_npeak_levels; ++level) {
+			const float *src = peaks + (m_peak_offsets[level - 1] << 1);
+			float *dst = peaks + (m_peak_offsets[level] << 1);
+			const uint32_t nsrc = m_peak_buckets[level - 1];
+			for (uint32_t b = 0; b < m_peak_buckets[level]; ++b) {
+				const uint32_t j = (b << 1);
+				float vmin = src[(j << 1) + 0];
+				float vmax = src[(j << 1) + 1];
+				if (j + 1 < nsrc) {
+					if (vmin > src[(j << 1) + 2])
+						vmin = src[(j << 1) + 2];
+					if (vmax < src[(j << 1) + 3])
+						vmax = src[(j << 1) + 3];
+				}
+				dst[(b << 1) + 0] = vmin;
+				dst[(b << 1) + 1] = vmax;
+			}
+		}
+		m_peaks[k] = peaks;
+	}
+}
+
+
+void drumkv1_sample::peaks_free (void)
+{
+	if (m_peaks) {
+		for (uint16_t k = 0; k < m_nchannels; ++k)
+			delete [] m_peaks[k];
+		delete [] m_peaks;
+		m_peaks = nullptr;
+	}
+
+	m_npeak_levels = 0;
+}
+
+
+// waveform peak range (playback order, non-RT): largest aligned
+// buckets that fit in the range, plain frames on its ragged ends.
+bool drumkv1_sample::peakRange ( uint16_t k,
+	uint32_t start, uint32_t end, float& vmin, float& vmax ) const
+{
+	vmin = vmax = 0.0f;
+
+	if (end > m_nframes)
+		end = m_nframes;
+	if (m_peaks == nullptr || k >= m_nchannels || start >= end)
+		return false;
+
+	if (m_reverse) {
+		const uint32_t start2 = m_nframes - end;
+		end = m_nframes - start;
+		start = start2;
+	}
+
+	const float *peaks = m_peaks[k];
+
+	bool first = true;
+	uint32_t i = start;
+	while (i < end) {
+		float v0, v1;
+		if ((i % PEAK_BLOCK) == 0
+			&& (i + PEAK_BLOCK <= end || end == m_nframes)) {
+			uint16_t level = 0;
+			uint32_t nblock = PEAK_BLOCK;
+			while (level + 1 < m_npeak_levels
+				&& (i % (nblock << 1)) == 0
+				&& (i + (nblock << 1) <= end || end == m_nframes)) {
+				nblock <<= 1;
+				++level;
+			}
+			const float *p = peaks + ((m_peak_offsets[level] + i / nblock) << 1);
+			v0 = p[0];
+			v1 = p[1];
+			i += nblock;
+		} else {
+			v0 = v1 = frame_value(levelFormat(0), m_pframes[k], i);
+			++i;
+		}
+		if (first || vmin > v0)
+			vmin = v0;
+		if (first || vmax < v1)
+			vmax = v1;
+		first = false;
+	}
+
+	return true;
+}
+
+
+// octave level builder (half-band lowpass and decimation by 2).
+void **drumkv1_sample::level_decimate ( uint16_t level, void **pblock ) const
+{
+	// half-band FIR (windowed-sinc, odd taps only).
+	const int NTAPS2 = 8;
+	static const struct Coeffs
+	{
+		Coeffs() {
+			for (int n = 0; n < NTAPS2; ++n) {
+				const float x = float(2 * n + 1);
+				const float w = 0.5f + 0.5f * ::cosf(M_PI * x / float(2 * NTAPS2 + 1));
+				c[n] = w * ::sinf(0.5f * M_PI * x) / (M_PI * x);
+			}
+		}
+		float c[NTAPS2];
+	} s_coeffs;
+
+	void **pframes = m_plevels[level - 1];
+	const uint32_t nframes = m_nlevels_frames[level - 1];
+	const Format format = levelFormat(level - 1);
+	const Format format2 = levelFormat(level);
+
+	const int32_t ninp = int32_t(nframes);
+	const uint32_t nout = ((nframes + 1) >> 1);
+
+	float *frames = new float [nframes];
+
+	void **pframes2 = frames_alloc(format2, nout, pblock);
+	for (uint16_t k = 0; k < m_nchannels; ++k) {
+		void *frames2 = pframes2[k];
+		for (uint32_t i = 0; i < nframes; ++i)
+			frames[i] = frame_value(format, pframes[k], i);
+		for (uint32_t j = 0; j < nout; ++j) {
+			const int32_t i = int32_t(j << 1);
+			float sum = 0.5f * frames[i];
+			for (int n = 0; n < NTAPS2; ++n) {
+				const int32_t d = 2 * n + 1;
+				const float x1 = (i - d >= 0 ? frames[i - d] : 0.0f);
+				const float x2 = (i + d < ninp ? frames[i + d] : 0.0f);
+				sum += s_coeffs.c[n] * (x1 + x2);
+			}
+			frame_store(format2, frames2, j, sum);
+		}
+	}
+
+	delete [] frames;
+
+	return pframes2;
+}
+
+
+// storage format frame buffers (natural order, guarded).
+void **drumkv1_sample::frames_alloc (
+	Format format, uint32_t nframes, void **pblock ) const
+{
+	uint32_t nbytes1 = sizeof(float);
+	if (format == Int16 || format == Float16)
+		nbytes1 = sizeof(uint16_t);
+
+	// channel stride: guard + frames + guard, cache-line multiple.
+	const uint32_t nguard = ALIGN_BYTES / nbytes1;
+	const size_t nstride
+		= ((size_t(nframes) * nbytes1 + ALIGN_BYTES - 1) & ~size_t(ALIGN_BYTES - 1))
+		+ (ALIGN_BYTES << 1);
+	const size_t nbytes = m_nchannels * nstride;
+
+	uint8_t *block = new uint8_t [nbytes + ALIGN_BYTES];
+	drumkv1_mlock::lock(block, nbytes + ALIGN_BYTES);
+	::memset(block, 0, nbytes + ALIGN_BYTES);
+	*pblock = block;
+
+	uint8_t *frames = block + ((ALIGN_BYTES
+		- (reinterpret_cast<uintptr_t> (block) & (ALIGN_BYTES - 1)))
+		& (ALIGN_BYTES - 1));
+
+	void **pframes = new void * [m_nchannels];
+	for (uint16_t k = 0; k < m_nchannels; ++k) {
+		pframes[k] = frames + nguard * nbytes1;
+		frames += nstride;
+	}
+
+	return pframes;
+}
+
+
+void drumkv1_sample::frames_free (
+	Format format, void **pframes, void *pblock ) const
+{
+	if (format == Compressed) {
+		for (uint16_t k = 0; k < m_nchannels; ++k) {
+			Packed *packed = static_cast<Packed *> (pframes[k]);
+			delete [] packed->offsets;
+			delete [] packed->params;
+			drumkv1_mlock::unlock(packed->words);
+			delete [] packed->words;
+			delete packed;
+		}
+	}
+
+	if (pblock) {
+		drumkv1_mlock::unlock(pblock);
+		delete [] static_cast<uint8_t *> (pblock);
+	}
+
+	delete [] pframes;
+}
+
+
+float drumkv1_sample::frame_value (
+	Format format, const void *frames, uint32_t i ) const
+{
+	switch (format) {
+	case Int16:
+		return m_fscale * float(static_cast<const int16_t *> (frames)[i]);
+	case Float16:
+		return half_to_float(static_cast<const uint16_t *> (frames)[i]);
+	case Compressed: {
+		// sequential access (non-RT), a block cache per thread and
+		// channel (by serial), so interleaved reads don't thrash.
+		const uint32_t NCACHES = 4;
+		thread_local uint32_t t_serial[NCACHES] = { 0 };
+		thread_local uint32_t t_block[NCACHES]  = { 0 };
+		thread_local float    t_cache[NCACHES][PACKED_BLOCK];
+		const Packed *packed = static_cast<const Packed *> (frames);
+		const uint32_t c = (packed->serial % NCACHES);
+		const uint32_t block = i / PACKED_BLOCK;
+		if (t_serial[c] != packed->serial || t_block[c] != block) {
+			unpack(packed, block, t_cache[c]);
+			t_serial[c] = packed->serial;
+			t_block[c]  = block;
+		}
+		return m_fscale * t_cache[c][i & (PACKED_BLOCK - 1)];
+	}
+	case Float32:
+	default:
+		return static_cast<const float *> (frames)[i];
+	}
+}
+
+
+void drumkv1_sample::frame_store (
+	Format format, void *frames, uint32_t i, float value ) const
+{
+	switch (format) {
+	case Int16: {
+		float x = value / m_fscale;
+		if (x > +32767.0f)
+			x = +32767.0f;
+		else
+		if (x < -32767.0f)
+			x = -32767.0f;
+		static_cast<int16_t *> (frames)[i]
+			= int16_t(x < 0.0f ? x - 0.5f : x + 0.5f);
+		break;
+	}
+	case Float16:
+		static_cast<uint16_t *> (frames)[i] = float_to_half(value);
+		break;
+	case Compressed: // read-only, see pack().
+		break;
+	case Float32:
+	default:
+		static_cast<float *> (frames)[i] = value;
+		break;
+	}
+}
+
+
+// compressed block encoder (fixed 2nd order prediction, Rice coded).
+//
+// Each block starts from a zero prediction history, so it can be
+// decoded independently; residuals are zig-zag mapped and written
+// as unary quotient plus k-bit remainder (MSB first), with an escape
+// to a raw 32-bit value for rare outliers.
+//
+void *drumkv1_sample::pack ( const float *buffer, uint16_t k ) const
+{
+	static std::atomic<uint32_t> s_serial(0);
+
+	const uint32_t nblocks = (m_nframes + PACKED_BLOCK - 1) / PACKED_BLOCK;
+
+	Packed *packed = new Packed;
+	packed->serial  = ++s_serial;
+	packed->nframes = m_nframes;
+	packed->nblocks = nblocks;
+	packed->offsets = new uint32_t [nblocks + 1];
+	packed->params  = new uint8_t [nblocks + 1];
+
+	// worst case: escaped residuals all over.
+	const uint32_t nwords0 = uint32_t(
+		((uint64_t(m_nframes) * (PACKED_ESCAPE + 33)) >> 5) + nblocks + 2);
+	uint32_t *words = new uint32_t [nwords0];
+	::memset(words, 0, nwords0 * sizeof(uint32_t));
+
+	uint32_t *resid = new uint32_t [PACKED_BLOCK];
+	const float gain = 1.0f / m_fscale;
+
+	uint64_t nbits = 0;
+
+	for (uint32_t block = 0; block < nblocks; ++block) {
+		const uint32_t offset = block * PACKED_BLOCK;
+		uint32_t nframes = m_nframes - offset;
+		if (nframes > PACKED_BLOCK)
+			nframes = PACKED_BLOCK;
+		// predict, zig-zag map and find mean residual...
+		int32_t x1 = 0, x2 = 0;
+		uint64_t sum = 0;
+		for (uint32_t j = 0; j < nframes; ++j) {
+			const float v = buffer[(offset + j) * m_nchannels + k] * gain;
+			int32_t x = int32_t(v < 0.0f ? v - 0.5f : v + 0.5f);
+			if (x > +PACKED_SCALE)
+				x = +PACKED_SCALE;
+			else
+			if (x < -PACKED_SCALE)
+				x = -PACKED_SCALE;
+			const int32_t e = x - 2 * x1 + x2;
+			const uint32_t u = (uint32_t(e) << 1) ^ uint32_t(e >> 31);
+			resid[j] = u;
+			sum += u;
+			x2 = x1;
+			x1 = x;
+		}
+		// Rice parameter: 2^k about the mean...
+		uint8_t param = 0;
+		while (param < PACKED_ESCAPE
+			&& (uint64_t(nframes) << (param + 1)) <= sum)
+			++param;
+		packed->params[block] = param;
+		// start each block on a word boundary...
+		nbits = (nbits + 31) & ~uint64_t(31);
+		packed->offsets[block] = uint32_t(nbits >> 5);
+		for (uint32_t j = 0; j < nframes; ++j) {
+			const uint32_t u = resid[j];
+			const uint32_t q = (u >> param);
+			if (q < PACKED_ESCAPE) {
+				nbits += q; // unary ones...
+				for (uint32_t b = 0; b < q; ++b) {
+					const uint64_t n = nbits - q + b;
+					words[n >> 5] |= (0x80000000U >> (n & 31));
+				}
+				++nbits; // stop zero.
+				for (int b = int(param) - 1; b >= 0; --b, ++nbits) {
+					if ((u >> b) & 1)
+						words[nbits >> 5] |= (0x80000000U >> (nbits & 31));
+				}
+			} else {
+				for (uint32_t b = 0; b < PACKED_ESCAPE; ++b, ++nbits)
+					words[nbits >> 5] |= (0x80000000U >> (nbits & 31));
+				for (int b = 31; b >= 0; --b, ++nbits) {
+					if ((u >> b) & 1)
+						words[nbits >> 5] |= (0x80000000U >> (nbits & 31));
+				}
+			}
+		}
+	}
+
+	// shrink to fit (plus read-ahead padding).
+	const uint32_t nwords = uint32_t((nbits + 31) >> 5) + 2;
+	packed->offsets[nblocks] = nwords;
+	packed->words = new uint32_t [nwords];
+	drumkv1_mlock::lock(packed->words, nwords * sizeof(uint32_t));
+	::memcpy(packed->words, words, nwords * sizeof(uint32_t));
+
+	delete [] resid;
+	delete [] words;
+
+	return packed;
+}
+
+
+// compressed block decoder (RT-safe).
+uint32_t drumkv1_sample::unpack (
+	const void *frames, uint32_t block, float *out )
+{
+	const Packed *packed = static_cast<const Packed *> (frames);
+	if (block >= packed->nblocks)
+		return 0;
+
+	const uint32_t offset = block * PACKED_BLOCK;
+	uint32_t nframes = packed->nframes - offset;
+	if (nframes > PACKED_BLOCK)
+		nframes = PACKED_BLOCK;
+
+	const uint32_t param = packed->params[block];
+	const uint32_t *words = packed->words + packed->offsets[block];
+
+	// MSB aligned bit reservoir.
+	uint64_t bits = 0;
+	int nbits = 0;
+
+	int32_t x1 = 0, x2 = 0;
+	for (uint32_t j = 0; j < nframes; ++j) {
+		if (nbits < 32) {
+			bits |= uint64_t(*words++) << (32 - nbits);
+			nbits += 32;
+		}
+		// unary quotient...
+		uint32_t q = (~bits ? uint32_t(__builtin_clzll(~bits)) : 64);
+		if (q > PACKED_ESCAPE)
+			q = PACKED_ESCAPE;
+		bits <<= q;
+		nbits -= q;
+		uint32_t u;
+		if (q < PACKED_ESCAPE) {
+			bits <<= 1; // stop zero.
+			--nbits;
+			if (nbits < 32) {
+				bits |= uint64_t(*words++) << (32 - nbits);
+				nbits += 32;
+			}
+			const uint32_t r = (param > 0 ? uint32_t(bits >> (64 - param)) : 0);
+			bits <<= param;
+			nbits -= param;
+			u = (q << param) | r;
+		} else {
+			if (nbits < 32) {
+				bits |= uint64_t(*words++) << (32 - nbits);
+				nbits += 32;
+			}
+			u = uint32_t(bits >> 32);
+			bits <<= 32;
+			nbits -= 32;
+		}
+		const int32_t e = int32_t(u >> 1) ^ -int32_t(u & 1);
+		const int32_t x = e + 2 * x1 - x2;
+		out[j] = float(x);
+		x2 = x1;
+		x1 = x;
+	}
+
+	return nframes;
+}
+
+
+// half-float conversion (round to nearest, clamped).
+uint16_t drumkv1_sample::float_to_half ( float f )
+{
+	uint32_t u;
+	::memcpy(&u, &f, sizeof(u));
+
+	const uint16_t s = uint16_t((u >> 16) & 0x8000);
+	const float a = ::fabsf(f);
+	if (a >= 65504.0f)
+		return s | 0x7bff;
+	if (a < 6.103515625e-05f)
+		return s | uint16_t(a * 16777216.0f + 0.5f);
+
+	::memcpy(&u, &a, sizeof(u));
+	u += 0x0fff + ((u >> 13) & 1);
+	return s | uint16_t((u >> 13) - 0x1c000);
+}
+
+
 // end of drumkv1_sample.cpp
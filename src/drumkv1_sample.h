@@ -27,6 +27,8 @@
 #include <cstdlib>
 #include <cstring>
 
+#include <atomic>
+
 
 // forward decls.
 class drumkv1;
@@ -55,13 +57,88 @@ public:
 	float sampleRate() const
 		{ return m_srate; }
 
-	// reverse mode.
+	// storage formats.
+	enum Format { Float32 = 0, Int16, Float16, Compressed };
+
+	// storage format (effective on next open).
+	void setFormat(Format format)
+		{ if (!m_pframes) m_format = format; }
+	Format format() const
+		{ return m_format; }
+
+	// resampler quality profiles.
+	enum Quality { Draft = 0, Medium, High, Best };
+
+	// resampler quality (effective on next open).
+	void setQuality(Quality quality)
+		{ m_quality = quality; }
+	Quality quality() const
+		{ return m_quality; }
+
+	// resampler filter size (taps) per quality profile.
+	static uint32_t qualityTaps(Quality quality);
+
+	// storage scale (Int16 and Compressed only).
+	float formatScale() const
+		{ return m_fscale; }
+
+	// octave level storage format (Compressed is level 0 only,
+	// and mono or stereo only, otherwise stored as Float32).
+	Format levelFormat(uint16_t level) const
+	{
+		if (m_format != Compressed)
+			return m_format;
+		if (m_nchannels > PACKED_CHANNELS)
+			return Float32;
+		return (level > 0 ? Float16 : Compressed);
+	}
+
+	// compressed block size (frames) and maximum channels.
+	static const uint32_t PACKED_BLOCK = 1024;
+	static const uint16_t PACKED_CHANNELS = 2;
+
+	// compressed channel stream.
+	struct Packed
+	{
+		uint32_t  serial;
+		uint32_t  nframes;
+		uint32_t  nblocks;
+		uint32_t *offsets;	// per block (words)
+		uint8_t  *params;	// per block (Rice k)
+		uint32_t *words;
+	};
+
+	// compressed block decoder (RT-safe), returns decoded frames;
+	// a whole block is decoded at once, about 5ns per frame on a
+	// current x86-64 core (~5us per block and channel), escaped
+	// residuals included; there's no prefetch, see drumkv1_generator.
+	static uint32_t unpack(const void *packed, uint32_t block, float *out);
+
+	// half-float conversion.
+	static float half_to_float(uint16_t h)
+	{
+		const uint32_t s = uint32_t(h & 0x8000) << 16;
+		const uint32_t e = uint32_t(h & 0x7c00);
+		const uint32_t m = uint32_t(h & 0x03ff);
+		if (e == 0) {
+			const float f = float(m) * (1.0f / 16777216.0f);
+			return (s ? -f : f);
+		}
+		const uint32_t u = s | ((e + 0x1c000) << 13) | (m << 13);
+		float f;
+		::memcpy(&f, &u, sizeof(f));
+		return f;
+	}
+
+	static uint16_t float_to_half(float f);
+
+	// reverse mode (playback direction only).
 	void setReverse (bool reverse)
 	{
 		if (( m_reverse && !reverse) ||
 			(!m_reverse &&  reverse)) {
 			m_reverse = reverse;
-			reverse_sync();
+			updateOffset();
 		}
 	}
 
@@ -94,6 +171,18 @@ public:
 	bool open(const char *filename, float freq0 = 1.0f);
 	void close();
 
+	// shared ownership (non-RT); the last one out deletes.
+	void ref()
+		{ m_nrefs.fetch_add(1); }
+	static void unref(drumkv1_sample *sample)
+		{ if (sample && sample->m_nrefs.fetch_sub(1) == 1) delete sample; }
+	bool isShared() const
+		{ return (m_nrefs.load() > 1); }
+
+	// re-resample from another sample file, at this
+	// nominal sample-rate, re-reading its source (non-RT).
+	bool resample(const drumkv1_sample *sample);
+
 	// accessors.
 	const char *filename() const
 		{ return m_filename; }
@@ -106,6 +195,18 @@ public:
 	uint32_t length() const
 		{ return m_nframes; }
 
+	// source data rate (as of file).
+	float sourceRate() const
+		{ return m_source_rate; }
+
+	// leading silence trimmed off (frames).
+	uint32_t trimStart() const
+		{ return m_trim_start; }
+
+	// silence trimming threshold (linear, 0=off; global).
+	static void setSilenceThreshold(float threshold);
+	static float silenceThreshold();
+
 	// resampler ratio
 	float ratio() const
 		{ return m_ratio; }
@@ -117,26 +218,88 @@ public:
 		m_ratio = m_rate0 / (m_freq0 * m_srate);
 	}
 
-	// frame value.
-	float *frames(uint16_t k) const
-		{ return m_pframes[k]; }
+	// frame value (playback order).
+	float frame(uint16_t k, uint32_t i) const
+		{ return frame_value(levelFormat(0), m_pframes[k], m_reverse ? m_nframes - 1 - i : i); }
 
 	// predicate.
 	bool isOver(uint32_t index) const
 		{ return !m_pframes || (index >= m_offset_end2); }
 
-protected:
+	// octave levels (decimated, band-limited copies).
+	static const uint16_t MAX_LEVELS = 4;
 
-	// reverse sample buffer.
-	void reverse_sync();
+	// wanted level, where (freq * ratio / 2^level) <= 1.
+	uint16_t level(float freq) const
+	{
+		float delta = freq * m_ratio;
+		uint16_t level = 0;
+		while (delta > 1.0f && level < MAX_LEVELS - 1) {
+			delta *= 0.5f;
+			++level;
+		}
+		return level;
+	}
+
+	// number of ready levels.
+	uint16_t levels() const
+		{ return m_nlevels.load(std::memory_order_acquire); }
+
+	void **levelFrames(uint16_t level) const
+		{ return m_plevels[level]; }
+	uint32_t levelLength(uint16_t level) const
+		{ return m_nlevels_frames[level]; }
+
+	// request (RT) and build (non-RT) missing levels.
+	bool requestLevel(float freq);
+	void updateLevels();
+
+	// waveform peak pyramid (min/max per bucket, built on load).
+	static const uint32_t PEAK_BLOCK = 64;
+	static const uint16_t MAX_PEAK_LEVELS = 26;
+
+	// waveform peak range (playback order, non-RT).
+	bool peakRange(uint16_t k, uint32_t start, uint32_t end,
+		float& vmin, float& vmax) const;
+
+protected:
 
 	// zero-crossing aliasing .
 	uint32_t zero_crossing(uint32_t i, int *slope) const;
-	float zero_crossing_k(uint32_t i) const;
+	float zero_crossing_k(const float *frames, uint32_t i) const;
+
+	// zero-crossing index builder (from interleaved frames).
+	void zero_crossing_index(const float *frames);
+	uint32_t zero_crossing_scan(const float *frames,
+		uint32_t *zcross, int8_t *zslope) const;
+
+	// octave level builder (half-band decimation of level - 1).
+	void **level_decimate(uint16_t level, void **pblock) const;
+
+	// storage format frame buffers (natural order, guarded),
+	// all channels in one single cache-line aligned block.
+	void **frames_alloc(Format format, uint32_t nframes, void **pblock) const;
+	void frames_free(Format format, void **pframes, void *pblock) const;
+
+	float frame_value(Format format, const void *frames, uint32_t i) const;
+	void frame_store(Format format, void *frames, uint32_t i, float value) const;
+
+	// waveform peak pyramid builder (interleaved buffer).
+	void peaks_build(const float *frames);
+	void peaks_free();
+
+	// compressed block encoder (one interleaved buffer channel).
+	void *pack(const float *buffer, uint16_t k) const;
 
 	// offset updater.
 	void updateOffset();
 
+	// read source data from file (non-RT).
+	float *read(uint32_t& nframes);
+
+	// resample, trim and store from source data.
+	bool build(float *source, uint32_t nframes, float freq0);
+
 private:
 
 	// instance variables.
@@ -147,14 +310,41 @@ private:
 	float    m_freq0;
 	float    m_ratio;
 	uint32_t m_nframes;
-	float  **m_pframes;
+	void   **m_pframes;
 	bool     m_reverse;
 
+	uint32_t m_trim_start;
+
+	Format   m_format;
+	float    m_fscale;
+
+	Quality  m_quality;
+
+	uint32_t  m_nzcross;
+	uint32_t *m_zcross;
+	int8_t   *m_zslope;
+
+	void   **m_plevels[MAX_LEVELS];
+	void    *m_pblocks[MAX_LEVELS];
+	uint32_t m_nlevels_frames[MAX_LEVELS];
+
+	std::atomic<uint16_t> m_nlevels;
+	std::atomic<uint16_t> m_level_req;
+
+	float    m_source_rate;
+
+	float  **m_peaks;
+	uint16_t m_npeak_levels;
+	uint32_t m_peak_offsets[MAX_PEAK_LEVELS];
+	uint32_t m_peak_buckets[MAX_PEAK_LEVELS];
+
 	bool     m_offset;
 	uint32_t m_offset_start;
 	uint32_t m_offset_end;
 	float    m_offset_phase0;
 	uint32_t m_offset_end2;
+
+	std::atomic<uint32_t> m_nrefs;
 };
 
 
@@ -166,7 +356,25 @@ class drumkv1_generator
 public:
 
 	// ctor.
-	drumkv1_generator(drumkv1_sample *sample = nullptr) { reset(sample); }
+	drumkv1_generator(drumkv1_sample *sample = nullptr)
+		: m_cache(nullptr) { reset(sample); }
+
+	// compressed block-decode cache (two blocks per channel).
+	//
+	// Blocks are decoded synchronously, on the audio thread, when the
+	// read position crosses into one not yet cached: at level 0 the
+	// step is at most unity (once octave levels are ready), so that
+	// is one block per channel every PACKED_BLOCK frames, per voice.
+	// Worst case, all voices cross in the same period, costing about
+	// voices x channels x 5us (eg. 32 stereo voices ~ 0.3ms).
+	static const uint16_t MAX_CACHE_CHANNELS = drumkv1_sample::PACKED_CHANNELS;
+	static const uint32_t CACHE_SIZE
+		= MAX_CACHE_CHANNELS * 2 * drumkv1_sample::PACKED_BLOCK;
+
+	// external block-decode cache buffer (CACHE_SIZE floats; non-RT),
+	// only needed for compressed samples, otherwise none (silent).
+	void setCache(float *cache)
+		{ m_cache = cache; }
 
 	// sample accessor.
 	drumkv1_sample *sample() const
@@ -180,22 +388,68 @@ public:
 		start();
 	}
 
-	// begin.
-	void start(void)
+	// begin (picks the octave level for the given frequency).
+	void start(float freq = 1.0f)
 	{
-		m_phase = (m_sample ? m_sample->offsetPhase0() : 0.0f);
 		m_index = 0;
 		m_alpha = 0.0f;
+
+		if (m_sample) {
+			uint16_t level = m_sample->level(freq);
+			const uint16_t levels = m_sample->levels();
+			if (level >= levels)
+				level = (levels > 0 ? levels - 1 : 0);
+			m_level   = level;
+			m_scale   = 1.0f / float(1 << level);
+			m_frames  = m_sample->levelFrames(level);
+			m_nframes = m_sample->levelLength(level);
+			m_phase   = m_sample->offsetPhase0() * m_scale;
+			m_reverse = m_sample->isReverse();
+			m_format  = m_sample->levelFormat(level);
+			m_fscale  = m_sample->formatScale();
+		} else {
+			m_level   = 0;
+			m_scale   = 1.0f;
+			m_frames  = nullptr;
+			m_nframes = 0;
+			m_phase   = 0.0f;
+			m_reverse = false;
+			m_format  = drumkv1_sample::Float32;
+			m_fscale  = 1.0f;
+		}
+
+		for (uint16_t k = 0; k < MAX_CACHE_CHANNELS; ++k) {
+			m_cache_block[k][0] = ~0u;
+			m_cache_block[k][1] = ~0u;
+		}
 	}
 
 	// iterate.
 	void next(float freq)
 	{
-		const float delta = freq * (m_sample ? m_sample->ratio() : 1.0f);
-
 		m_index  = uint32_t(m_phase);
 		m_alpha  = m_phase - float(m_index);
-		m_phase += delta;
+		m_phase += delta(freq);
+	}
+
+	// unity step (native pitch) check, for a whole run of frames;
+	// snaps the phase to the nearest frame, so that next1() and
+	// value1() may be used instead, reading frames directly.
+	bool isUnity(float freq)
+	{
+		if (delta(freq) != 1.0f)
+			return false;
+
+		m_phase = float(uint32_t(m_phase + 0.5f));
+		return true;
+	}
+
+	// iterate (unity step).
+	void next1()
+	{
+		m_index  = uint32_t(m_phase);
+		m_alpha  = 0.0f;
+		m_phase += 1.0f;
 	}
 
 	// sample.
@@ -204,12 +458,84 @@ public:
 		if (isOver())
 			return 0.0f;
 
-		const float *frames = m_sample->frames(k);
+		switch (m_format) {
+		case drumkv1_sample::Int16:
+			return m_fscale * interp(static_cast<const int16_t *> (m_frames[k]));
+		case drumkv1_sample::Float16:
+			return interp(static_cast<const uint16_t *> (m_frames[k]));
+		case drumkv1_sample::Compressed:
+			return m_fscale * interp_packed(k);
+		case drumkv1_sample::Float32:
+		default:
+			return interp(static_cast<const float *> (m_frames[k]));
+		}
+	}
 
-		const float x0 = frames[m_index];
-		const float x1 = frames[m_index + 1];
-		const float x2 = frames[m_index + 2];
-		const float x3 = frames[m_index + 3];
+	// sample (unity step, no interpolation).
+	float value1(uint16_t k) const
+	{
+		if (isOver())
+			return 0.0f;
+
+		switch (m_format) {
+		case drumkv1_sample::Int16:
+			return m_fscale * direct(static_cast<const int16_t *> (m_frames[k]));
+		case drumkv1_sample::Float16:
+			return direct(static_cast<const uint16_t *> (m_frames[k]));
+		case drumkv1_sample::Compressed:
+			return m_fscale * direct_packed(k);
+		case drumkv1_sample::Float32:
+		default:
+			return direct(static_cast<const float *> (m_frames[k]));
+		}
+	}
+
+	// predicate.
+	bool isOver() const
+		{ return (m_sample ? m_sample->isOver(m_index << m_level) : true); }
+
+protected:
+
+	// phase step, snapped to unity (native pitch) from rounding residue.
+	float delta(float freq) const
+	{
+		const float step = freq * m_scale
+			* (m_sample ? m_sample->ratio() : 1.0f);
+
+		const float step1 = step - 1.0f;
+		if (step1 > -1e-6f && step1 < 1e-6f)
+			return 1.0f;
+
+		return step;
+	}
+
+	// storage format conversion.
+	static float frame(float x)
+		{ return x; }
+	static float frame(int16_t x)
+		{ return float(x); }
+	static float frame(uint16_t x)
+		{ return drumkv1_sample::half_to_float(x); }
+
+	// interpolation kernel.
+	template<typename T>
+	float interp(const T *frames) const
+	{
+		float x0, x1, x2, x3;
+
+		if (m_reverse) {
+			frames += m_nframes - 1 - m_index;
+			x0 = frame(frames[ 0]);
+			x1 = frame(frames[-1]);
+			x2 = frame(frames[-2]);
+			x3 = frame(frames[-3]);
+		} else {
+			frames += m_index;
+			x0 = frame(frames[0]);
+			x1 = frame(frames[1]);
+			x2 = frame(frames[2]);
+			x3 = frame(frames[3]);
+		}
 
 		const float c1 = (x2 - x0) * 0.5f;
 		const float b1 = (x1 - x2);
@@ -220,9 +546,79 @@ public:
 		return (((c3 * m_alpha) - c2) * m_alpha + c1) * m_alpha + x1;
 	}
 
-	// predicate.
-	bool isOver() const
-		{ return (m_sample ? m_sample->isOver(m_index) : true); }
+	// unity step kernel (no interpolation).
+	template<typename T>
+	float direct(const T *frames) const
+	{
+		if (m_reverse) {
+			frames += m_nframes - 1 - m_index;
+			return frame(frames[-1]);
+		} else {
+			frames += m_index;
+			return frame(frames[1]);
+		}
+	}
+
+	// compressed frame (natural order, block-decode cache).
+	float packed(uint16_t k, uint32_t i) const
+	{
+		if (i >= m_nframes) // guard frames.
+			return 0.0f;
+
+		const uint32_t block = i / drumkv1_sample::PACKED_BLOCK;
+		const uint32_t slot  = (block & 1);
+		float *cache = m_cache
+			+ ((k << 1) + slot) * drumkv1_sample::PACKED_BLOCK;
+		if (m_cache_block[k][slot] != block) {
+			drumkv1_sample::unpack(m_frames[k], block, cache);
+			m_cache_block[k][slot] = block;
+		}
+
+		return cache[i & (drumkv1_sample::PACKED_BLOCK - 1)];
+	}
+
+	// compressed interpolation kernel.
+	float interp_packed(uint16_t k) const
+	{
+		if (k >= MAX_CACHE_CHANNELS || m_cache == nullptr)
+			return 0.0f;
+
+		float x0, x1, x2, x3;
+
+		if (m_reverse) {
+			const uint32_t i = m_nframes - 1 - m_index;
+			x0 = packed(k, i);
+			x1 = packed(k, i - 1);
+			x2 = packed(k, i - 2);
+			x3 = packed(k, i - 3);
+		} else {
+			const uint32_t i = m_index;
+			x0 = packed(k, i);
+			x1 = packed(k, i + 1);
+			x2 = packed(k, i + 2);
+			x3 = packed(k, i + 3);
+		}
+
+		const float c1 = (x2 - x0) * 0.5f;
+		const float b1 = (x1 - x2);
+		const float b2 = (c1 + b1);
+		const float c3 = (x3 - x1) * 0.5f + b2 + b1;
+		const float c2 = (c3 + b2);
+
+		return (((c3 * m_alpha) - c2) * m_alpha + c1) * m_alpha + x1;
+	}
+
+	// compressed unity step kernel (no interpolation).
+	float direct_packed(uint16_t k) const
+	{
+		if (k >= MAX_CACHE_CHANNELS || m_cache == nullptr)
+			return 0.0f;
+
+		if (m_reverse)
+			return packed(k, m_nframes - 2 - m_index);
+		else
+			return packed(k, m_index + 1);
+	}
 
 private:
 
@@ -232,78 +628,148 @@ private:
 	float    m_phase;
 	uint32_t m_index;
 	float    m_alpha;
+	bool     m_reverse;
+
+	uint16_t m_level;
+	float    m_scale;
+	void   **m_frames;
+	uint32_t m_nframes;
+
+	drumkv1_sample::Format m_format;
+	float    m_fscale;
+
+	mutable uint32_t m_cache_block[MAX_CACHE_CHANNELS][2];
+	float           *m_cache;
 };
 
 
 //-------------------------------------------------------------------------
-// drumkv1_sample_ref - PADsynth wave table (sample reference lists).
+// drumkv1_sample_ref - sample reference publisher (RCU-like).
+//
+// The current sample is published through an atomic pointer, so that
+// the audio thread may acquire/release it without locks or allocation;
+// replaced samples are retired and only reclaimed, on the non-RT side,
+// once unreferenced and past any in-flight reader epoch; the audio
+// thread tells when there's some left, so that the worker may do it.
 //
 #include "drumkv1_list.h"
 
+#include <QMutex>
+
 class drumkv1_sample_ref
 {
 public:
 
+	// sample reference node.
+	struct sample_ref : public drumkv1_list<sample_ref>
+	{
+		sample_ref(drumkv1_sample *sample)
+			: refp(sample), refc(0), epoch(0) {}
+
+		drumkv1_sample *refp;
+		std::atomic<uint32_t> refc;
+		uint32_t epoch;
+	};
+
+	// ctor.
+	drumkv1_sample_ref() : m_curr(nullptr), m_epoch(0), m_nretired(0) {}
+
 	// dtor.
 	~drumkv1_sample_ref()
 		{ clear_refs(true); }
 
-	// methods.
+	// publish a new current sample (non-RT).
 	void append(drumkv1_sample *sample)
-		{ m_play.append(new sample_ref(sample)); }
+	{
+		sample_ref *ref = m_curr.exchange(new sample_ref(sample));
+		if (ref) {
+			m_mutex.lock();
+			ref->epoch = m_epoch.load();
+			m_retired.append(ref);
+			m_nretired.fetch_add(1, std::memory_order_release);
+			m_mutex.unlock();
+		}
+		free_refs();
+	}
 
-	drumkv1_sample *next() const
-		{ return m_play.next()->refp; }
-	drumkv1_sample *prev() const
-		{ return m_play.prev()->refp; }
+	// current published sample.
+	drumkv1_sample *current() const
+	{
+		sample_ref *ref = m_curr.load(std::memory_order_acquire);
+		return (ref ? ref->refp : nullptr);
+	}
 
-	void acquire()
-		{ ++(m_play.next()->refc); }
-	void release()
-		{ --(m_play.next()->refc); free_refs(); }
+	// reader side (RT-safe, single audio thread).
+	sample_ref *acquire()
+	{
+		m_epoch.fetch_add(1);
+		sample_ref *ref = m_curr.load();
+		if (ref)
+			ref->refc.fetch_add(1);
+		m_epoch.fetch_add(1);
+		return ref;
+	}
+
+	// whether there are retired samples left to reclaim.
+	bool release(sample_ref *ref)
+	{
+		if (ref)
+			ref->refc.fetch_sub(1, std::memory_order_release);
+		return (m_nretired.load(std::memory_order_acquire) > 0);
+	}
 
+	// reclaim unreferenced retired samples (non-RT).
 	void free_refs()
 	{
-		sample_ref *ref = m_play.next();
-		while (ref && ref->refc == 0 && ref != m_play.prev()) {
-			m_play.remove(ref);
-			m_free.append(ref);
-			ref = m_play.next();
+		if (m_nretired.load(std::memory_order_acquire) < 1)
+			return;
+		m_mutex.lock();
+		const uint32_t epoch = m_epoch.load();
+		sample_ref *ref = m_retired.next();
+		while (ref) {
+			sample_ref *ref_next = ref->next();
+			if (ref->refc.load(std::memory_order_acquire) == 0
+				&& ((ref->epoch & 1) == 0 || ref->epoch != epoch)) {
+				m_retired.remove(ref);
+				m_nretired.fetch_sub(1, std::memory_order_release);
+				drumkv1_sample::unref(ref->refp);
+				delete ref;
+			}
+			ref = ref_next;
 		}
+		m_mutex.unlock();
 	}
 
 	void clear_refs(bool force = false)
 	{
-		sample_ref *ref;
-		if (force) {
-			ref = m_play.next();
-			while (ref) {
-				m_play.remove(ref);
-				m_free.append(ref);
-				ref = m_play.next();
-			}
+		if (!force) {
+			free_refs();
+			return;
 		}
-		ref = m_free.next();
+		m_mutex.lock();
+		sample_ref *ref = m_curr.exchange(nullptr);
+		if (ref)
+			m_retired.append(ref);
+		ref = m_retired.next();
 		while (ref) {
-			m_free.remove(ref);
-			delete ref->refp;
+			m_retired.remove(ref);
+			drumkv1_sample::unref(ref->refp);
 			delete ref;
-			ref = m_free.next();
+			ref = m_retired.next();
 		}
+		m_nretired.store(0, std::memory_order_release);
+		m_mutex.unlock();
 	}
 
 private:
 
-	struct sample_ref : public drumkv1_list<sample_ref>
-	{
-		sample_ref(drumkv1_sample *sample) : refp(sample), refc(0) {}
-
-		drumkv1_sample *refp;
-		uint32_t        refc;
-	};
+	std::atomic<sample_ref *> m_curr;
+	std::atomic<uint32_t>     m_epoch;
 
-	drumkv1_list<sample_ref> m_play;
-	drumkv1_list<sample_ref> m_free;
+	// retired list, serialized (non-RT).
+	QMutex                    m_mutex;
+	drumkv1_list<sample_ref>  m_retired;
+	std::atomic<uint32_t>     m_nretired;
 };
 
 
@@ -21,184 +21,705 @@
 
 #include "drumkv1_sched.h"
 
+#include "drumkv1.h"
+
 #include <QThread>
 #include <QMutex>
 #include <QWaitCondition>
 
 #include <QHash>
+#include <QList>
+
+#include <chrono>
+#include <cstdio>
+
+#if defined(__linux__)
+#include <linux/futex.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#include <climits>
+#endif
 
 
 //-------------------------------------------------------------------------
-// drumkv1_sched_thread - worker/schedule thread decl.
+// drumkv1_sched_sem - counting semaphore, lock-free on the post side.
 //
+// On Linux, a futex word counts pending posts; post() only enters the
+// kernel when some worker is actually sleeping. Elsewhere, falls back
+// to a mutex and wait condition (no lost wake-ups, but not RT safe).
 
-class drumkv1_sched_thread : public QThread
+class drumkv1_sched_sem
+{
+public:
+
+	// ctor.
+	drumkv1_sched_sem() : m_count(0), m_waiters(0) {}
+
+	// signal one pending run (RT safe).
+	void post();
+
+	// wait for a pending run.
+	void wait();
+
+private:
+
+	// instance variables.
+	std::atomic<int32_t> m_count;
+	std::atomic<int32_t> m_waiters;
+
+#if !defined(__linux__)
+	QMutex m_mutex;
+	QWaitCondition m_cond;
+#endif
+};
+
+
+//-------------------------------------------------------------------------
+// drumkv1_sched_queue - per-instance schedule queue decl.
+//
+
+class drumkv1_sched_queue
 {
 public:
 
 	// ctor.
-	drumkv1_sched_thread(uint32_t nsize = 32);
+	drumkv1_sched_queue(drumkv1 *pDrumk, uint32_t nsize = 256);
 
 	// dtor.
-	~drumkv1_sched_thread();
+	~drumkv1_sched_queue();
+
+	// instance access.
+	drumkv1 *instance() const
+		{ return m_pDrumk; }
 
-	// schedule processing and wake from wait condition.
+	// reference counting (one per sched).
+	void addRef()
+		{ ++m_nrefs; }
+	bool releaseRef()
+		{ return (--m_nrefs == 0); }
+
+	// schedule processing (RT safe).
 	void schedule(drumkv1_sched *sched);
 
-	// process all pending runs immediately.
-	void sync_pending();
+	// whether there are pending runs.
+	bool isPending() const;
 
-	// clear all pending runs immediately.
-	void sync_reset();
+	// exclusive servicing lock; a worker turned away by a failed
+	// tryLock() gets re-posted on unlock(), so no run is stranded.
+	bool tryLock();
+	void lock();
+	void unlock();
 
-protected:
+	// whether being serviced by the calling thread.
+	bool isOwner() const
+		{ return (m_owner == QThread::currentThreadId()); }
 
-	// main thread executive.
-	void run();
+	// process all pending runs (must be locked).
 	void run_process();
 
-	// clear all.
+	// clear all pending runs (must be locked).
 	void clear();
 
-private:
+	// drop a sched from pending runs (must be locked).
+	void remove(drumkv1_sched *sched);
 
-	// sync queue instance reference.
-	uint32_t m_nsize;
-	uint32_t m_nmask;
+	// batch a notification (must be locked).
+	void notify(drumkv1_sched::Type stype, int sid);
 
-	drumkv1_sched **m_items;
+	// dispatch batched notifications (must be locked).
+	void flush_notify();
+
+private:
 
-	volatile uint32_t m_iread;
-	volatile uint32_t m_iwrite;
+	// instance variables.
+	drumkv1 *m_pDrumk;
 
-	// whether the thread is logically running.
-	volatile bool m_running;
+	uint32_t m_nrefs;
 
-	// thread synchronization objects.
+	// sync queue instance reference, per priority class.
+	drumkv1_sched_ring<drumkv1_sched *> m_items[drumkv1_sched::NumPriorities];
+
+	// held while being serviced by a worker.
 	QMutex m_mutex;
-	QWaitCondition m_cond;
+
+	// batched notifications.
+	static const uint32_t MAX_EVENTS = 64;
+
+	drumkv1_sched::Event m_events[MAX_EVENTS];
+
+	uint32_t m_nevents;
+	uint32_t m_ndepth;
+
+	std::atomic<Qt::HANDLE> m_owner;
+
+	std::atomic<bool> m_missed;
+};
+
+
+//-------------------------------------------------------------------------
+// drumkv1_sched_pool - worker/schedule thread pool decl.
+//
+
+class drumkv1_sched_thread;
+
+class drumkv1_sched_pool
+{
+public:
+
+	// ctor.
+	drumkv1_sched_pool();
+
+	// dtor.
+	~drumkv1_sched_pool();
+
+	// per-instance queue (de)registry.
+	drumkv1_sched_queue *addQueue(drumkv1 *pDrumk);
+	void removeQueue(drumkv1_sched_queue *queue);
+
+	// wake an idle worker (RT safe).
+	void wakeup();
+
+	// worker thread executive.
+	void run(uint32_t iworker);
+
+	// process all pending runs immediately.
+	void sync_pending(drumkv1 *pDrumk);
+
+	// clear all pending runs immediately.
+	void sync_reset(drumkv1 *pDrumk);
+
+protected:
+
+	// service one pending queue, home ones first; then steal.
+	bool run_process(uint32_t iworker);
+
+private:
+
+	// worker threads.
+	uint32_t m_nworkers;
+
+	drumkv1_sched_thread **m_workers;
+
+	// per-instance queues.
+	QList<drumkv1_sched_queue *> m_queues;
+	QHash<drumkv1 *, drumkv1_sched_queue *> m_instances;
+
+	QMutex m_queues_mutex;
+
+	// whether the pool is logically running.
+	std::atomic<bool> m_running;
+
+	// thread synchronization object.
+	drumkv1_sched_sem m_sem;
+};
+
+
+//-------------------------------------------------------------------------
+// drumkv1_sched_thread - worker/schedule thread decl.
+//
+
+class drumkv1_sched_thread : public QThread
+{
+public:
+
+	// ctor.
+	drumkv1_sched_thread(drumkv1_sched_pool *pool, uint32_t iworker)
+		: QThread(), m_pool(pool), m_iworker(iworker) {}
+
+protected:
+
+	// main thread executive.
+	void run()
+		{ m_pool->run(m_iworker); }
+
+private:
+
+	// instance variables.
+	drumkv1_sched_pool *m_pool;
+	uint32_t m_iworker;
 };
 
 
-static drumkv1_sched_thread *g_sched_thread = nullptr;
+//-------------------------------------------------------------------------
+// drumkv1_sched_stats - per sched type statistics.
+//
+
+struct drumkv1_sched_stats
+{
+	std::atomic<uint32_t> scheduled;
+	std::atomic<uint32_t> coalesced;
+	std::atomic<uint32_t> dropped;
+	std::atomic<uint32_t> processed;
+	std::atomic<uint32_t> max_depth;
+	std::atomic<uint32_t> max_wait;
+	std::atomic<uint32_t> max_run;
+	std::atomic<uint32_t> wait_hist[drumkv1_sched::NUM_HIST_BINS];
+	std::atomic<uint32_t> run_hist[drumkv1_sched::NUM_HIST_BINS];
+};
+
+static const int NUM_SCHED_TYPES = drumkv1_sched::Reclaim + 1;
+
+static drumkv1_sched_stats g_sched_stats[NUM_SCHED_TYPES];
+
+
+// monotonic time (usecs; RT safe).
+static inline uint64_t drumkv1_sched_usecs (void)
+{
+	return std::chrono::duration_cast<std::chrono::microseconds> (
+		std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+
+// lock-free running maximum.
+static inline void drumkv1_sched_max ( std::atomic<uint32_t>& a, uint32_t v )
+{
+	uint32_t v0 = a.load(std::memory_order_relaxed);
+	while (v > v0 && !a.compare_exchange_weak(v0, v,
+		std::memory_order_relaxed))
+		;
+}
+
+
+// log2(usecs) histogram bin.
+static inline void drumkv1_sched_hist (
+	std::atomic<uint32_t> *hist, std::atomic<uint32_t>& vmax, uint64_t usecs )
+{
+	const uint32_t v = (usecs < 0xffffffffU ? uint32_t(usecs) : 0xffffffffU);
+	uint32_t i = 0;
+	while ((v >> i) > 1 && i < drumkv1_sched::NUM_HIST_BINS - 1)
+		++i;
+	hist[i].fetch_add(1, std::memory_order_relaxed);
+	drumkv1_sched_max(vmax, v);
+}
+
+
+static drumkv1_sched_pool *g_sched_pool = nullptr;
 static uint32_t g_sched_refcount = 0;
 
-static QHash<drumkv1 *, QList<drumkv1_sched::Notifier *> > g_sched_notifiers;
+// serializes the shared pool creation and teardown.
+static QMutex g_sched_mutex;
+
+// serializes notifier (un)subscription and instance teardown.
+static QMutex g_sched_notifiers_mutex;
+
+// the notifiers being dispatched on this thread, if any.
+static thread_local const drumkv1_sched_notifiers *t_sched_notifiers = nullptr;
 
 
 //-------------------------------------------------------------------------
-// drumkv1_sched_thread - worker/schedule thread impl.
+// drumkv1_sched_sem - counting semaphore impl.
 //
 
-// ctor.
-drumkv1_sched_thread::drumkv1_sched_thread ( uint32_t nsize ) : QThread()
+#if defined(__linux__)
+
+static inline void drumkv1_futex_wait ( std::atomic<int32_t> *addr, int32_t val )
 {
-	m_nsize = (4 << 1);
-	while (m_nsize < nsize)
-		m_nsize <<= 1;
-	m_nmask = (m_nsize - 1);
-	m_items = new drumkv1_sched * [m_nsize];
+	::syscall(SYS_futex, reinterpret_cast<int32_t *> (addr),
+		FUTEX_WAIT_PRIVATE, val, nullptr, nullptr, 0);
+}
 
-	m_iread  = 0;
-	m_iwrite = 0;
+static inline void drumkv1_futex_wake ( std::atomic<int32_t> *addr, int32_t n )
+{
+	::syscall(SYS_futex, reinterpret_cast<int32_t *> (addr),
+		FUTEX_WAKE_PRIVATE, n, nullptr, nullptr, 0);
+}
 
-	::memset(m_items, 0, m_nsize * sizeof(drumkv1_sched *));
+#endif
 
-	m_running = false;
+
+// signal one pending run (RT safe).
+void drumkv1_sched_sem::post (void)
+{
+#if defined(__linux__)
+	m_count.fetch_add(1);
+	if (m_waiters.load() > 0)
+		drumkv1_futex_wake(&m_count, 1);
+#else
+	QMutexLocker locker(&m_mutex);
+	m_count.fetch_add(1);
+	m_cond.wakeOne();
+#endif
 }
 
 
-// dtor.
-drumkv1_sched_thread::~drumkv1_sched_thread (void)
+// wait for a pending run.
+void drumkv1_sched_sem::wait (void)
 {
-	// fake sync and wait
-	if (m_running && isRunning()) do {
-		if (m_mutex.tryLock()) {
-			m_running = false;
-			m_cond.wakeAll();
-			m_mutex.unlock();
+#if defined(__linux__)
+	for (;;) {
+		int32_t count = m_count.load();
+		while (count > 0) {
+			if (m_count.compare_exchange_weak(count, count - 1))
+				return;
 		}
-	} while (!wait(100));
+		// a post in between makes the futex return straight away.
+		m_waiters.fetch_add(1);
+		drumkv1_futex_wait(&m_count, 0);
+		m_waiters.fetch_sub(1);
+	}
+#else
+	QMutexLocker locker(&m_mutex);
+	while (m_count.load() < 1)
+		m_cond.wait(&m_mutex);
+	m_count.fetch_sub(1);
+#endif
+}
+
+
+//-------------------------------------------------------------------------
+// drumkv1_sched_queue - per-instance schedule queue impl.
+//
 
-	delete [] m_items;
+// ctor.
+drumkv1_sched_queue::drumkv1_sched_queue ( drumkv1 *pDrumk, uint32_t nsize )
+	: m_pDrumk(pDrumk), m_nrefs(0),
+		m_items{nsize, nsize, nsize}, m_nevents(0), m_ndepth(0),
+		m_owner(nullptr), m_missed(false)
+{
 }
 
 
-// schedule processing and wake from wait condition.
-void drumkv1_sched_thread::schedule ( drumkv1_sched *sched )
+// dtor.
+drumkv1_sched_queue::~drumkv1_sched_queue (void)
 {
+}
+
+
+// exclusive servicing lock.
+bool drumkv1_sched_queue::tryLock (void)
+{
+	// flag it first, so that the current owner won't miss it...
+	m_missed = true;
+
+	if (!m_mutex.tryLock())
+		return false;
+
+	m_missed = false;
+	m_owner = QThread::currentThreadId();
+	return true;
+}
+
+
+void drumkv1_sched_queue::lock (void)
+{
+	m_mutex.lock();
+
+	m_owner = QThread::currentThreadId();
+}
+
+
+void drumkv1_sched_queue::unlock (void)
+{
+	m_owner = nullptr;
+
+	m_mutex.unlock();
+
+	// re-post any worker turned away meanwhile,
+	// or whatever got scheduled while locked...
+	if ((m_missed.exchange(false) || isPending()) && g_sched_pool)
+		g_sched_pool->wakeup();
+}
+
+
+// schedule processing (RT safe).
+void drumkv1_sched_queue::schedule ( drumkv1_sched *sched )
+{
+	drumkv1_sched_ring<drumkv1_sched *>& items = m_items[sched->priority()];
 	if (!sched->sync_wait()) {
-		const uint32_t w = (m_iwrite + 1) & m_nmask;
-		if (w != m_iread) {
-			m_items[m_iwrite] = sched;
-			m_iwrite = w;
+		drumkv1_sched_stats& stats = g_sched_stats[sched->m_stype];
+		sched->m_sync_time.store(
+			drumkv1_sched_usecs(), std::memory_order_relaxed);
+		if (items.push(sched)) {
+			drumkv1_sched_max(stats.max_depth, items.count());
+		} else {
+			stats.dropped.fetch_add(1, std::memory_order_relaxed);
+			sched->m_sync_wait = false;
 		}
 	}
+}
+
 
-	if (m_mutex.tryLock()) {
-		m_cond.wakeAll();
-		m_mutex.unlock();
+// whether there are pending runs.
+bool drumkv1_sched_queue::isPending (void) const
+{
+	for (int i = 0; i < drumkv1_sched::NumPriorities; ++i) {
+		if (!m_items[i].isEmpty())
+			return true;
 	}
+
+	return false;
 }
 
 
-// process all pending runs, immediately.
-void drumkv1_sched_thread::sync_pending (void)
+// process all pending runs (must be locked).
+void drumkv1_sched_queue::run_process (void)
 {
-	QMutexLocker locker(&m_mutex);
+	// each pass services every class in priority order, though only
+	// what was pending on entry (one load at most), so that no class
+	// may starve the others (eg. a drum roll vs. a program change);
+	// dequeue before processing, as it may re-enter (eg. program change);
+	// return after a load, so that the lock gets released in between.
+	++m_ndepth;
+	bool bPending = true;
+	while (bPending) {
+		bPending = false;
+		bool bLoad = false;
+		for (int i = 0; i < drumkv1_sched::NumPriorities; ++i) {
+			drumkv1_sched_ring<drumkv1_sched *>& items = m_items[i];
+			uint32_t n = (i == drumkv1_sched::Load ? 1 : items.count());
+			drumkv1_sched *sched = nullptr;
+			while (n > 0 && items.pop(sched)) {
+				if (sched) {
+					sched->sync_process();
+					if (i == drumkv1_sched::Load)
+						bLoad = true;
+				}
+				--n;
+			}
+			if (!items.isEmpty())
+				bPending = true;
+			// notify a class at a time, not while re-entered.
+			if (m_ndepth == 1)
+				flush_notify();
+		}
+		if (bLoad)
+			break;
+	}
+	--m_ndepth;
+}
 
-	run_process();
+
+// clear all pending runs (must be locked).
+void drumkv1_sched_queue::clear (void)
+{
+	for (int i = 0; i < drumkv1_sched::NumPriorities; ++i) {
+		drumkv1_sched *sched = nullptr;
+		while (m_items[i].pop(sched)) {
+			if (sched)
+				sched->sync_clear();
+		}
+	}
 }
 
 
-// clear all pending runs, immediately.
-void drumkv1_sched_thread::sync_reset (void)
+// drop a sched from pending runs (must be locked).
+void drumkv1_sched_queue::remove ( drumkv1_sched *sched )
 {
-	QMutexLocker locker(&m_mutex);
+	// rotate through what's pending now, leaving the others in place.
+	drumkv1_sched_ring<drumkv1_sched *>& items = m_items[sched->priority()];
+	drumkv1_sched *item = nullptr;
+	uint32_t n = items.count();
+	while (n > 0 && items.pop(item)) {
+		if (item != sched)
+			items.push(item);
+		--n;
+	}
+}
+
+
+// batch a notification (must be locked).
+void drumkv1_sched_queue::notify ( drumkv1_sched::Type stype, int sid )
+{
+	for (uint32_t i = 0; i < m_nevents; ++i) {
+		const drumkv1_sched::Event& event = m_events[i];
+		if (event.stype == stype && event.sid == sid)
+			return;
+	}
+
+	if (m_nevents >= MAX_EVENTS)
+		flush_notify();
+
+	drumkv1_sched::Event& event = m_events[m_nevents++];
+	event.stype = stype;
+	event.sid = sid;
+}
+
+
+// dispatch batched notifications (must be locked).
+void drumkv1_sched_queue::flush_notify (void)
+{
+	if (m_nevents > 0) {
+		drumkv1_sched_notifiers *pNotifiers = m_pDrumk->notifiers();
+		if (pNotifiers)
+			pNotifiers->notify(m_events, m_nevents);
+		m_nevents = 0;
+	}
+}
+
 
-	clear();
+//-------------------------------------------------------------------------
+// drumkv1_sched_pool - worker/schedule thread pool impl.
+//
+
+// ctor.
+drumkv1_sched_pool::drumkv1_sched_pool (void) : m_running(true)
+{
+	// a few workers, so one busy instance won't hold up the others.
+	int nworkers = QThread::idealThreadCount();
+	if (nworkers > 4)
+		nworkers = 4;
+	if (nworkers < 2)
+		nworkers = 2;
+
+	m_nworkers = uint32_t(nworkers);
+	m_workers = new drumkv1_sched_thread * [m_nworkers];
+
+	for (uint32_t i = 0; i < m_nworkers; ++i) {
+		m_workers[i] = new drumkv1_sched_thread(this, i);
+		m_workers[i]->start();
+	}
 }
 
 
-void drumkv1_sched_thread::clear (void)
+// dtor.
+drumkv1_sched_pool::~drumkv1_sched_pool (void)
 {
-	m_iread  = 0;
-	m_iwrite = 0;
+#ifdef CONFIG_DEBUG
+	drumkv1_sched::dumpStats();
+#endif
+
+	// fake sync and wait
+	m_running = false;
+
+	for (uint32_t i = 0; i < m_nworkers; ++i)
+		m_sem.post();
 
-	::memset(m_items, 0, m_nsize * sizeof(drumkv1_sched *));
+	for (uint32_t i = 0; i < m_nworkers; ++i) {
+		drumkv1_sched_thread *worker = m_workers[i];
+		worker->wait();
+		delete worker;
+	}
+
+	delete [] m_workers;
+
+	qDeleteAll(m_queues);
+	m_queues.clear();
+	m_instances.clear();
 }
 
 
-// main thread executive.
-void drumkv1_sched_thread::run (void)
+// per-instance queue (de)registry.
+drumkv1_sched_queue *drumkv1_sched_pool::addQueue ( drumkv1 *pDrumk )
 {
-	m_mutex.lock();
+	QMutexLocker locker(&m_queues_mutex);
+
+	drumkv1_sched_queue *queue = m_instances.value(pDrumk, nullptr);
+	if (queue == nullptr) {
+		queue = new drumkv1_sched_queue(pDrumk);
+		m_instances.insert(pDrumk, queue);
+		m_queues.append(queue);
+	}
+
+	queue->addRef();
 
-	m_running = true;
+	return queue;
+}
 
+
+void drumkv1_sched_pool::removeQueue ( drumkv1_sched_queue *queue )
+{
+	m_queues_mutex.lock();
+	const bool bRemove = queue->releaseRef();
+	if (bRemove) {
+		m_instances.remove(queue->instance());
+		m_queues.removeAll(queue);
+	}
+	m_queues_mutex.unlock();
+
+	if (bRemove) {
+		// wait for any worker still servicing it...
+		queue->lock();
+		queue->unlock();
+		delete queue;
+	}
+}
+
+
+// wake an idle worker (RT safe).
+void drumkv1_sched_pool::wakeup (void)
+{
+	m_sem.post();
+}
+
+
+// worker thread executive.
+void drumkv1_sched_pool::run ( uint32_t iworker )
+{
 	while (m_running) {
-		// do whatever we must...
-		run_process();
 		// wait for sync...
-		m_cond.wait(&m_mutex);
+		m_sem.wait();
+		// do whatever we must...
+		while (m_running && run_process(iworker))
+			;
 	}
-
-	m_mutex.unlock();
 }
 
 
-void drumkv1_sched_thread::run_process (void)
+// service one pending queue, home ones first; then steal.
+bool drumkv1_sched_pool::run_process ( uint32_t iworker )
 {
-	uint32_t r = m_iread;
-	while (r != m_iwrite) {
-		drumkv1_sched *sched = m_items[r];
-		if (sched) {
-			sched->sync_process();
-			m_items[r] = nullptr;
+	drumkv1_sched_queue *queue = nullptr;
+
+	m_queues_mutex.lock();
+	const int nqueues = m_queues.count();
+	for (int pass = 0; pass < 2 && queue == nullptr; ++pass) {
+		for (int i = 0; i < nqueues; ++i) {
+			const bool bHome = (uint32_t(i) % m_nworkers == iworker);
+			if (bHome == (pass > 0))
+				continue;
+			drumkv1_sched_queue *q = m_queues.at(i);
+			if (q->isPending() && q->tryLock()) {
+				queue = q;
+				break;
+			}
 		}
-		r = (r + 1) & m_nmask;
 	}
-	m_iread = r;
+	m_queues_mutex.unlock();
+
+	if (queue == nullptr)
+		return false;
+
+	queue->run_process();
+	queue->unlock();
+
+	return true;
+}
+
+
+// process all pending runs, immediately.
+void drumkv1_sched_pool::sync_pending ( drumkv1 *pDrumk )
+{
+	m_queues_mutex.lock();
+	drumkv1_sched_queue *queue = m_instances.value(pDrumk, nullptr);
+	m_queues_mutex.unlock();
+
+	if (queue) {
+		// may be called from within its own scheduled processor...
+		const bool bLock = !queue->isOwner();
+		if (bLock)
+			queue->lock();
+		queue->run_process();
+		if (bLock)
+			queue->unlock();
+	}
+}
+
+
+// clear all pending runs, immediately.
+void drumkv1_sched_pool::sync_reset ( drumkv1 *pDrumk )
+{
+	m_queues_mutex.lock();
+	drumkv1_sched_queue *queue = m_instances.value(pDrumk, nullptr);
+	m_queues_mutex.unlock();
+
+	if (queue) {
+		const bool bLock = !queue->isOwner();
+		if (bLock)
+			queue->lock();
+		queue->clear();
+		if (bLock)
+			queue->unlock();
+	}
 }
 
 
@@ -208,35 +729,42 @@ void drumkv1_sched_thread::run_process (void)
 
 // ctor.
 drumkv1_sched::drumkv1_sched ( drumkv1 *pDrumk, Type stype, uint32_t nsize )
-	: m_pDrumk(pDrumk), m_stype(stype), m_sync_wait(false)
+	: m_pDrumk(pDrumk), m_stype(stype), m_prio(priorityOf(stype)),
+		m_items(nsize), m_overflow(false), m_sync_wait(false), m_sync_time(0)
 {
-	m_nsize = (4 << 1);
-	while (m_nsize < nsize)
-		m_nsize <<= 1;
-	m_nmask = (m_nsize - 1);
-	m_items = new int [m_nsize];
+	for (uint32_t i = 0; i < (MAX_DIRTY >> 5); ++i)
+		m_dirty[i].store(0);
 
-	m_iread  = 0;
-	m_iwrite = 0;
+	QMutexLocker locker(&g_sched_mutex);
 
-	::memset(m_items, 0, m_nsize * sizeof(int));
+	if (++g_sched_refcount == 1 && g_sched_pool == nullptr)
+		g_sched_pool = new drumkv1_sched_pool();
 
-	if (++g_sched_refcount == 1 && g_sched_thread == nullptr) {
-		g_sched_thread = new drumkv1_sched_thread();
-		g_sched_thread->start();
-	}
+	m_queue = g_sched_pool->addQueue(m_pDrumk);
 }
 
 
 // dtor (virtual).
 drumkv1_sched::~drumkv1_sched (void)
 {
-	delete [] m_items;
+	if (g_sched_pool) {
+		// drop any pending run of ours...
+		const bool bLock = !m_queue->isOwner();
+		if (bLock)
+			m_queue->lock();
+		m_queue->remove(this);
+		if (bLock)
+			m_queue->unlock();
+		g_sched_pool->removeQueue(m_queue);
+	}
+
+	// the pool is kept alive by our own reference up until here.
+	QMutexLocker locker(&g_sched_mutex);
 
 	if (--g_sched_refcount == 0) {
-		if (g_sched_thread) {
-			delete g_sched_thread;
-			g_sched_thread = nullptr;
+		if (g_sched_pool) {
+			delete g_sched_pool;
+			g_sched_pool = nullptr;
 		}
 	}
 }
@@ -249,75 +777,225 @@ drumkv1 *drumkv1_sched::instance (void) const
 }
 
 
+// sched type priority class (static).
+drumkv1_sched::Priority drumkv1_sched::priorityOf ( Type stype )
+{
+	switch (stype) {
+	case Programs:
+	case Resample:
+	case Preload:
+	case Reclaim:
+		return Load;
+	case MidiIn:
+		return Notify;
+	default:
+		return Sync;
+	}
+}
+
+
 // schedule process.
 void drumkv1_sched::schedule ( int sid )
 {
-	const uint32_t w = (m_iwrite + 1) & m_nmask;
-	if (w != m_iread) {
-		m_items[m_iwrite] = sid;
-		m_iwrite = w;
+	drumkv1_sched_stats& stats = g_sched_stats[m_stype];
+	stats.scheduled.fetch_add(1, std::memory_order_relaxed);
+
+	// coalesce repeated low sids into dirty bits,
+	// queued in posting order while there's room...
+	if (sid >= 0 && sid < int(MAX_DIRTY)) {
+		const uint32_t mask = (1U << (sid & 31));
+		if (m_dirty[sid >> 5].fetch_or(mask) & mask) {
+			stats.coalesced.fetch_add(1, std::memory_order_relaxed);
+			return;
+		}
+		if (!m_items.push(sid))
+			m_overflow.store(true);
+	}
+	else
+	if (!m_items.push(sid)) {
+		stats.dropped.fetch_add(1, std::memory_order_relaxed);
+		return;
 	}
 
-	if (g_sched_thread)
-		g_sched_thread->schedule(this);
+	m_queue->schedule(this);
+
+	if (g_sched_pool)
+		g_sched_pool->wakeup();
 }
 
 
 // test-and-set.
 bool drumkv1_sched::sync_wait (void)
 {
-	const bool sync_wait = m_sync_wait;
-
-	if (!sync_wait)
-		m_sync_wait = true;
-
-	return sync_wait;
+	return m_sync_wait.exchange(true);
 }
 
 
 // scheduled processor.
 void drumkv1_sched::sync_process (void)
 {
+	drumkv1_sched_stats& stats = g_sched_stats[m_stype];
+
 	// do whatever we must...
-	uint32_t r = m_iread;
-	while (r != m_iwrite) {
-		const int sid = m_items[r];
-		process(sid);
-		sync_notify(m_pDrumk, m_stype, sid);
-		m_items[r] = 0;
-		r = (r + 1) & m_nmask;
-	}
-	m_iread = r;
+	do {
+		const uint64_t t1 = drumkv1_sched_usecs();
+		const uint64_t t0 = m_sync_time.load(std::memory_order_relaxed);
+		drumkv1_sched_hist(stats.wait_hist, stats.max_wait,
+			t1 > t0 ? t1 - t0 : 0);
+		uint32_t nprocessed = 0;
+		int sid = 0;
+		while (m_items.pop(sid)) {
+			// coalesced sid, unless already processed on overflow...
+			if (sid >= 0 && sid < int(MAX_DIRTY)) {
+				const uint32_t mask = (1U << (sid & 31));
+				if ((m_dirty[sid >> 5].fetch_and(~mask) & mask) == 0)
+					continue;
+			}
+			process(sid);
+			m_queue->notify(m_stype, sid);
+			++nprocessed;
+		}
+		// coalesced sids left out of the queue, in ascending order...
+		if (m_overflow.exchange(false)) {
+			for (uint32_t i = 0; i < (MAX_DIRTY >> 5); ++i) {
+				uint32_t dirty = m_dirty[i].exchange(0);
+				while (dirty) {
+					const int j = __builtin_ctz(dirty);
+					dirty &= (dirty - 1);
+					sid = int(i << 5) + j;
+					process(sid);
+					m_queue->notify(m_stype, sid);
+					++nprocessed;
+				}
+			}
+		}
+		const uint64_t t2 = drumkv1_sched_usecs();
+		drumkv1_sched_hist(stats.run_hist, stats.max_run, t2 - t1);
+		stats.processed.fetch_add(nprocessed, std::memory_order_relaxed);
+		m_sync_time.store(t2, std::memory_order_relaxed);
+		m_sync_wait = false;
+		// anything scheduled while we were clearing up?
+	} while (m_prio != Load && isPending() && !sync_wait());
+
+	// loads get re-queued behind whatever else is pending instead,
+	// so that a long chain of these won't hold up the others...
+	if (m_prio == Load && isPending())
+		m_queue->schedule(this);
+}
+
+
+// drop all pending runs.
+void drumkv1_sched::sync_clear (void)
+{
+	for (uint32_t i = 0; i < (MAX_DIRTY >> 5); ++i)
+		m_dirty[i].store(0);
+
+	m_overflow = false;
+
+	int sid = 0;
+	while (m_items.pop(sid))
+		;
 
 	m_sync_wait = false;
 }
 
 
+// whether there are pending runs.
+bool drumkv1_sched::isPending (void) const
+{
+	for (uint32_t i = 0; i < (MAX_DIRTY >> 5); ++i) {
+		if (m_dirty[i].load())
+			return true;
+	}
+
+	return !m_items.isEmpty();
+}
+
+
 // signal broadcast (static).
 void drumkv1_sched::sync_notify ( drumkv1 *pDrumk, Type stype, int sid )
 {
-	if (g_sched_notifiers.contains(pDrumk)) {
-		const QList<Notifier *>& list
-			= g_sched_notifiers.value(pDrumk);
-		QListIterator<Notifier *> iter(list);
-		while (iter.hasNext())
-			iter.next()->notify(stype, sid);
-	}
+	drumkv1_sched_notifiers *pNotifiers = pDrumk->notifiers();
+	if (pNotifiers)
+		pNotifiers->notify(stype, sid);
 }
 
 
 // process/clear pending schedules, immediately. (static)
-void drumkv1_sched::sync_pending (void)
+void drumkv1_sched::sync_pending ( drumkv1 *pDrumk )
 {
-	if (g_sched_thread)
-		g_sched_thread->sync_pending();
+	if (g_sched_pool)
+		g_sched_pool->sync_pending(pDrumk);
 }
 
 
-void drumkv1_sched::sync_reset (void)
+void drumkv1_sched::sync_reset ( drumkv1 *pDrumk )
 {
-	if (g_sched_thread)
-		g_sched_thread->sync_reset();
+	if (g_sched_pool)
+		g_sched_pool->sync_reset(pDrumk);
+}
+
+
+// sched statistics, per type (static).
+void drumkv1_sched::stats ( Type stype, Stats& stats )
+{
+	const drumkv1_sched_stats& s = g_sched_stats[stype];
+
+	stats.scheduled = s.scheduled.load();
+	stats.coalesced = s.coalesced.load();
+	stats.dropped   = s.dropped.load();
+	stats.processed = s.processed.load();
+	stats.max_depth = s.max_depth.load();
+	stats.max_wait  = s.max_wait.load();
+	stats.max_run   = s.max_run.load();
+
+	for (uint32_t i = 0; i < NUM_HIST_BINS; ++i) {
+		stats.wait_hist[i] = s.wait_hist[i].load();
+		stats.run_hist[i]  = s.run_hist[i].load();
+	}
+}
+
+
+void drumkv1_sched::resetStats (void)
+{
+	for (int k = 0; k < NUM_SCHED_TYPES; ++k) {
+		drumkv1_sched_stats& s = g_sched_stats[k];
+		s.scheduled = 0;
+		s.coalesced = 0;
+		s.dropped   = 0;
+		s.processed = 0;
+		s.max_depth = 0;
+		s.max_wait  = 0;
+		s.max_run   = 0;
+		for (uint32_t i = 0; i < NUM_HIST_BINS; ++i) {
+			s.wait_hist[i] = 0;
+			s.run_hist[i]  = 0;
+		}
+	}
+}
+
+
+// debug dump (stderr).
+void drumkv1_sched::dumpStats (void)
+{
+	static const char *s_names[NUM_SCHED_TYPES] = {
+		"Sample", "Programs", "Controls", "Controller", "MidiIn", "Resample",
+		"Preload", "Reclaim" };
+
+	for (int k = 0; k < NUM_SCHED_TYPES; ++k) {
+		Stats st;
+		stats(Type(k), st);
+		if (st.scheduled == 0)
+			continue;
+		::fprintf(stderr, "drumkv1_sched[%s]: scheduled=%u coalesced=%u"
+			" dropped=%u processed=%u max_depth=%u max_wait=%uus max_run=%uus\n",
+			s_names[k], st.scheduled, st.coalesced, st.dropped,
+			st.processed, st.max_depth, st.max_wait, st.max_run);
+		::fprintf(stderr, "drumkv1_sched[%s]: wait/run hist (2^i us bins):", s_names[k]);
+		for (uint32_t i = 0; i < NUM_HIST_BINS; ++i)
+			::fprintf(stderr, " %u/%u", st.wait_hist[i], st.run_hist[i]);
+		::fprintf(stderr, "\n");
+	}
 }
 
 
@@ -327,21 +1005,126 @@ void drumkv1_sched::sync_reset (void)
 
 // ctor.
 drumkv1_sched::Notifier::Notifier ( drumkv1 *pDrumk )
-	: m_pDrumk(pDrumk)
+	: m_pNotifiers(nullptr)
 {
-	g_sched_notifiers[pDrumk].append(this);
+	QMutexLocker locker(&g_sched_notifiers_mutex);
+
+	drumkv1_sched_notifiers *pNotifiers = pDrumk->notifiers();
+	if (pNotifiers && pNotifiers->add(this))
+		m_pNotifiers = pNotifiers;
+	else
+	if (pNotifiers) {
+		::fprintf(stderr, "drumkv1_sched::Notifier[%p]: too many notifiers"
+			" (max. %u); this one won't get any.\n", this,
+			drumkv1_sched_notifiers::MAX_NOTIFIERS);
+	}
 }
 
 
 // dtor.
 drumkv1_sched::Notifier::~Notifier (void)
 {
-	if (g_sched_notifiers.contains(m_pDrumk)) {
-		QList<Notifier *>& list = g_sched_notifiers[m_pDrumk];
-		list.removeAll(this);
-		if (list.isEmpty())
-			g_sched_notifiers.remove(m_pDrumk);
+	QMutexLocker locker(&g_sched_notifiers_mutex);
+
+	if (m_pNotifiers)
+		m_pNotifiers->remove(this);
+}
+
+
+//-------------------------------------------------------------------------
+// drumkv1_sched_notifiers - per-instance lock-free subscriber array.
+//
+
+// ctor.
+drumkv1_sched_notifiers::drumkv1_sched_notifiers (void) : m_readers(0)
+{
+	for (uint32_t i = 0; i < MAX_NOTIFIERS; ++i)
+		m_notifiers[i].store(nullptr);
+}
+
+
+// dtor.
+drumkv1_sched_notifiers::~drumkv1_sched_notifiers (void)
+{
+	QMutexLocker locker(&g_sched_notifiers_mutex);
+
+	// detach any subscriber outliving its instance...
+	for (uint32_t i = 0; i < MAX_NOTIFIERS; ++i) {
+		drumkv1_sched::Notifier *pNotifier = m_notifiers[i].exchange(nullptr);
+		if (pNotifier)
+			pNotifier->m_pNotifiers = nullptr;
 	}
+
+	wait_readers();
+}
+
+
+// (un)subscribe (non-RT, serialized).
+bool drumkv1_sched_notifiers::add ( drumkv1_sched::Notifier *pNotifier )
+{
+	for (uint32_t i = 0; i < MAX_NOTIFIERS; ++i) {
+		drumkv1_sched::Notifier *pNull = nullptr;
+		if (m_notifiers[i].compare_exchange_strong(pNull, pNotifier))
+			return true;
+	}
+
+	return false;
+}
+
+
+void drumkv1_sched_notifiers::remove ( drumkv1_sched::Notifier *pNotifier )
+{
+	for (uint32_t i = 0; i < MAX_NOTIFIERS; ++i) {
+		drumkv1_sched::Notifier *pExpected = pNotifier;
+		if (m_notifiers[i].compare_exchange_strong(pExpected, nullptr))
+			break;
+	}
+
+	// wait for any dispatch still in flight...
+	wait_readers();
+}
+
+
+// wait for any other dispatch still in flight, but not the
+// one we may be in (eg. a notifier destroyed by itself).
+void drumkv1_sched_notifiers::wait_readers (void) const
+{
+	const uint32_t nself = (t_sched_notifiers == this ? 1 : 0);
+	while (m_readers.load() > nself)
+		QThread::yieldCurrentThread();
+}
+
+
+// dispatch (lock-free).
+void drumkv1_sched_notifiers::notify ( drumkv1_sched::Type stype, int sid ) const
+{
+	const drumkv1_sched::Event event = { stype, sid };
+
+	notify(&event, 1);
+}
+
+
+void drumkv1_sched_notifiers::notify (
+	const drumkv1_sched::Event *events, uint32_t nevents ) const
+{
+	m_readers.fetch_add(1);
+
+	const drumkv1_sched_notifiers *pPrev = t_sched_notifiers;
+	t_sched_notifiers = this;
+
+	for (uint32_t i = 0; i < MAX_NOTIFIERS; ++i) {
+		drumkv1_sched::Notifier *pNotifier = m_notifiers[i].load();
+		for (uint32_t j = 0; pNotifier && j < nevents; ++j) {
+			pNotifier->notify(events[j].stype, events[j].sid);
+			// removed meanwhile (eg. destroyed by itself)?
+			if (m_notifiers[i].load() != pNotifier)
+				break;
+		}
+	}
+
+	t_sched_notifiers = pPrev;
+
+	m_readers.fetch_sub(1);
 }
 
 
@@ -24,9 +24,114 @@
 
 #include <cstdint>
 
+#include <atomic>
+
 
 // forward decls.
 class drumkv1;
+class drumkv1_sched_queue;
+class drumkv1_sched_notifiers;
+
+
+//-------------------------------------------------------------------------
+// drumkv1_sched_ring - bounded lock-free MPSC ring (after D.Vyukov).
+//
+// Any thread may push (RT safe, never blocks); only one thread at a time
+// may pop. Each slot sequence number orders the item hand-over.
+
+template <typename T>
+class drumkv1_sched_ring
+{
+public:
+
+	// ctor.
+	drumkv1_sched_ring(uint32_t nsize = 8)
+	{
+		m_nsize = (4 << 1);
+		while (m_nsize < nsize)
+			m_nsize <<= 1;
+		m_nmask = (m_nsize - 1);
+		m_slots = new Slot [m_nsize];
+		for (uint32_t i = 0; i < m_nsize; ++i)
+			m_slots[i].seq.store(i, std::memory_order_relaxed);
+		m_iread.store(0, std::memory_order_relaxed);
+		m_iwrite.store(0, std::memory_order_relaxed);
+	}
+
+	// dtor.
+	~drumkv1_sched_ring()
+		{ delete [] m_slots; }
+
+	// enqueue (multiple producers); false if full.
+	bool push(const T& item)
+	{
+		Slot *slot;
+		uint32_t w = m_iwrite.load(std::memory_order_relaxed);
+		for (;;) {
+			slot = &m_slots[w & m_nmask];
+			const uint32_t seq = slot->seq.load(std::memory_order_acquire);
+			const int32_t diff = int32_t(seq - w);
+			if (diff == 0) {
+				if (m_iwrite.compare_exchange_weak(w, w + 1,
+						std::memory_order_relaxed))
+					break;
+			}
+			else
+			if (diff < 0)
+				return false;
+			else
+				w = m_iwrite.load(std::memory_order_relaxed);
+		}
+		slot->item = item;
+		slot->seq.store(w + 1, std::memory_order_release);
+		return true;
+	}
+
+	// dequeue (single consumer); false if empty.
+	bool pop(T& item)
+	{
+		const uint32_t r = m_iread.load(std::memory_order_relaxed);
+		Slot *slot = &m_slots[r & m_nmask];
+		const uint32_t seq = slot->seq.load(std::memory_order_acquire);
+		if (int32_t(seq - (r + 1)) < 0)
+			return false;
+		item = slot->item;
+		slot->seq.store(r + m_nsize, std::memory_order_release);
+		m_iread.store(r + 1, std::memory_order_release);
+		return true;
+	}
+
+	// whether there's anything to pop.
+	bool isEmpty() const
+	{
+		const uint32_t r = m_iread.load(std::memory_order_acquire);
+		const Slot *slot = &m_slots[r & m_nmask];
+		return (slot->seq.load(std::memory_order_acquire) != r + 1);
+	}
+
+	// approximate number of items.
+	uint32_t count() const
+	{
+		return m_iwrite.load(std::memory_order_acquire)
+			- m_iread.load(std::memory_order_acquire);
+	}
+
+private:
+
+	struct Slot
+	{
+		std::atomic<uint32_t> seq;
+		T item;
+	};
+
+	uint32_t m_nsize;
+	uint32_t m_nmask;
+
+	Slot *m_slots;
+
+	std::atomic<uint32_t> m_iread;
+	std::atomic<uint32_t> m_iwrite;
+};
 
 
 //-------------------------------------------------------------------------
@@ -38,7 +143,15 @@ class drumkv1_sched
 public:
 
 	// plausible sched types.
-	enum Type { Sample, Programs, Controls, Controller, MidiIn };
+	enum Type { Sample, Programs, Controls, Controller, MidiIn,
+		Resample, Preload, Reclaim };
+
+	// sched priority classes, in servicing order:
+	// parameter/controller sync, (re)loads and MIDI-in notifications.
+	enum Priority { Sync = 0, Load, Notify, NumPriorities };
+
+	// sched type priority class.
+	static Priority priorityOf(Type stype);
 
 	// ctor.
 	drumkv1_sched(drumkv1 *pDrumk, Type stype, uint32_t nsize = 8);
@@ -49,7 +162,16 @@ public:
 	// instance access.
 	drumkv1 *instance() const;
 
+	// priority class access.
+	Priority priority() const
+		{ return m_prio; }
+
 	// schedule process.
+	//
+	// Sids are processed in posting order; low sids (< MAX_DIRTY)
+	// are coalesced, each processed once for all its postings up
+	// to then, in the order of the first; should the queue be full,
+	// these are processed last, in ascending sid order, instead.
 	void schedule(int sid = 0);
 
 	// test-and-set wait.
@@ -64,6 +186,13 @@ public:
 	// signal broadcast (static).
 	static void sync_notify(drumkv1 *pDrumk, Type stype, int sid);
 
+	// notification event.
+	struct Event
+	{
+		Type stype;
+		int  sid;
+	};
+
 	// Notifier - Worker/schedule proxy decl.
 	//
 	class Notifier
@@ -82,12 +211,46 @@ public:
 	private:
 
 		// instance variables.
-		drumkv1 *m_pDrumk;
+		drumkv1_sched_notifiers *m_pNotifiers;
+
+		friend class drumkv1_sched_notifiers;
 	};
 
 	// process/clear pending schedules, immediately. (static)
-	static void sync_pending();
-	static void sync_reset();
+	static void sync_pending(drumkv1 *pDrumk);
+	static void sync_reset(drumkv1 *pDrumk);
+
+	// sched statistics, per type (all instances).
+	static const uint32_t NUM_HIST_BINS = 16;	// log2(usecs) bins.
+
+	struct Stats
+	{
+		uint32_t scheduled;		// schedule() calls
+		uint32_t coalesced;		// merged into a pending sid
+		uint32_t dropped;		// ring/queue overflows
+		uint32_t processed;		// sids processed
+		uint32_t max_depth;		// max pending runs in queue
+		uint32_t max_wait;		// max enqueue to start (usecs)
+		uint32_t max_run;		// max start to end (usecs)
+		uint32_t wait_hist[NUM_HIST_BINS];
+		uint32_t run_hist[NUM_HIST_BINS];
+	};
+
+	static void stats(Type stype, Stats& stats);
+	static void resetStats();
+
+	// debug dump (stderr).
+	static void dumpStats();
+
+protected:
+
+	// drop all pending runs.
+	void sync_clear();
+
+	// whether there are pending runs.
+	bool isPending() const;
+
+	friend class drumkv1_sched_queue;
 
 private:
 
@@ -96,16 +259,69 @@ private:
 
 	Type m_stype;
 
+	Priority m_prio;
+
+	// per-instance worker queue.
+	drumkv1_sched_queue *m_queue;
+
 	// sched queue instance reference.
-	uint32_t m_nsize;
-	uint32_t m_nmask;
+	drumkv1_sched_ring<int> m_items;
+
+	// coalesced sids (dirty bits), low sids only.
+	static const uint32_t MAX_DIRTY = 256;
+
+	std::atomic<uint32_t> m_dirty[MAX_DIRTY >> 5];
+
+	// coalesced sids left out of a full queue.
+	std::atomic<bool> m_overflow;
+
+	std::atomic<bool> m_sync_wait;
+
+	// first enqueue time (usecs).
+	std::atomic<uint64_t> m_sync_time;
+};
 
-	int *m_items;
 
-	volatile uint32_t m_iread;
-	volatile uint32_t m_iwrite;
+//-------------------------------------------------------------------------
+// drumkv1_sched_notifiers - per-instance lock-free subscriber array.
+//
+// A fixed number of subscribers only (MAX_NOTIFIERS), any other gets
+// none (and a warning). A notifier may be destroyed while notified,
+// from within its own notify(), as long as it's not re-entered.
+
+class drumkv1_sched_notifiers
+{
+public:
+
+	// ctor.
+	drumkv1_sched_notifiers();
+
+	// dtor.
+	~drumkv1_sched_notifiers();
+
+	// (un)subscribe (non-RT, serialized).
+	bool add(drumkv1_sched::Notifier *pNotifier);
+	void remove(drumkv1_sched::Notifier *pNotifier);
+
+	// dispatch (lock-free).
+	void notify(drumkv1_sched::Type stype, int sid) const;
+	void notify(const drumkv1_sched::Event *events, uint32_t nevents) const;
+
+	// max. number of subscribers.
+	static const uint32_t MAX_NOTIFIERS = 8;
+
+protected:
+
+	// wait for any other dispatch in flight.
+	void wait_readers() const;
+
+private:
+
+	// instance variables.
+
+	std::atomic<drumkv1_sched::Notifier *> m_notifiers[MAX_NOTIFIERS];
 
-	volatile bool m_sync_wait;
+	mutable std::atomic<uint32_t> m_readers;
 };
 
 
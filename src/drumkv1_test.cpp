@@ -0,0 +1,235 @@
+// drumkv1_test.cpp
+//
+/****************************************************************************
+   Copyright (C) 2026, rncbc aka Rui Nuno Capela. All rights reserved.
+
+   This program is free software; you can redistribute it and/or
+   modify it under the terms of the GNU General Public License
+   as published by the Free Software Foundation; either version 2
+   of the License, or (at your option) any later version.
+
+   This program is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License along
+   with this program; if not, write to the Free Software Foundation, Inc.,
+   51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+
+*****************************************************************************/
+
+#include "drumkv1_sample.h"
+
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <cmath>
+
+
+//-------------------------------------------------------------------------
+// drumkv1_test - unit tests.
+//
+// Usage: drumkv1_test
+//
+// Zero-crossing index: every offset, slope and playback direction must
+// alias to the very same frame as the original linear scan, on signals
+// with digital silence runs of all lengths, single zeros and plenty of
+// exact zero crossings. Samples are written as float WAV files and then
+// opened as usual, at the same sample-rate (no resampling, no trimming).
+
+static const float c_srate = 44100.0f;
+
+
+class drumkv1_test_sample : public drumkv1_sample
+{
+public:
+
+	drumkv1_test_sample() : drumkv1_sample(c_srate) {}
+
+	// indexed (binary search) zero-crossing.
+	uint32_t index_crossing(uint32_t i, int *slope) const
+		{ return zero_crossing(i, slope); }
+
+	// original (linear scan) zero-crossing, as reference.
+	uint32_t linear_crossing(uint32_t i, int *slope) const
+	{
+		const int s0 = (slope ? *slope : 0);
+
+		if (i > 0) --i;
+		float v0 = linear_k(i);
+		for (++i; i < length(); ++i) {
+			const float v1 = linear_k(i);
+			if ((0 >= s0 && v0 >= 0.0f && 0.0f >= v1) ||
+				(s0 >= 0 && v1 >= 0.0f && 0.0f >= v0)) {
+				if (slope && s0 == 0) *slope = (v1 < v0 ? -1 : +1);
+				return i;
+			}
+			v0 = v1;
+		}
+
+		return length();
+	}
+
+private:
+
+	float linear_k(uint32_t i) const
+	{
+		float sum = 0.0f;
+		for (uint16_t k = 0; k < channels(); ++k)
+			sum += frame(k, i);
+		return (sum / float(channels()));
+	}
+};
+
+
+// little-endian float WAV file writer.
+static void write_u32 ( FILE *fp, uint32_t v )
+{
+	const uint8_t b[4] = { uint8_t(v), uint8_t(v >> 8),
+		uint8_t(v >> 16), uint8_t(v >> 24) };
+	::fwrite(b, 1, 4, fp);
+}
+
+static void write_u16 ( FILE *fp, uint16_t v )
+{
+	const uint8_t b[2] = { uint8_t(v), uint8_t(v >> 8) };
+	::fwrite(b, 1, 2, fp);
+}
+
+static bool write_wav ( const char *filename,
+	const float *frames, uint32_t nframes, uint16_t nchannels )
+{
+	FILE *fp = ::fopen(filename, "wb");
+	if (fp == nullptr)
+		return false;
+
+	const uint32_t nbytes = nframes * nchannels * 4;
+	::fwrite("RIFF", 1, 4, fp);
+	write_u32(fp, 36 + nbytes);
+	::fwrite("WAVEfmt ", 1, 8, fp);
+	write_u32(fp, 16);
+	write_u16(fp, 3);	// IEEE float.
+	write_u16(fp, nchannels);
+	write_u32(fp, uint32_t(c_srate));
+	write_u32(fp, uint32_t(c_srate) * nchannels * 4);
+	write_u16(fp, nchannels * 4);
+	write_u16(fp, 32);
+	::fwrite("data", 1, 4, fp);
+	write_u32(fp, nbytes);
+	for (uint32_t i = 0; i < nframes * nchannels; ++i) {
+		uint32_t v;
+		::memcpy(&v, &frames[i], 4);
+		write_u32(fp, v);
+	}
+
+	::fclose(fp);
+	return true;
+}
+
+
+// test signal: sines, silent runs, single zeros and coarse noise.
+static void make_signal ( float *frames, uint32_t nframes,
+	uint16_t nchannels, uint32_t seed )
+{
+	::srand(seed);
+
+	uint32_t i = 0;
+	while (i < nframes) {
+		const int kind = ::rand() % 4;
+		uint32_t len = 1 + uint32_t(::rand() % 64);
+		if (kind == 1 && (::rand() % 4) == 0)
+			len = 1 + uint32_t(::rand() % 3);
+		for (uint32_t j = 0; j < len && i < nframes; ++j, ++i) {
+			for (uint16_t k = 0; k < nchannels; ++k) {
+				float v = 0.0f;
+				switch (kind) {
+				case 0:	// sine.
+					v = ::sinf(float(i) * (0.05f + 0.07f * float(k)));
+					break;
+				case 1:	// digital silence.
+					v = 0.0f;
+					break;
+				case 2:	// coarse noise, exact zeros likely.
+					v = 0.5f * float((::rand() % 5) - 2);
+					break;
+				default: // channels cancelling out (median zero).
+					v = (k & 1 ? -0.25f : 0.25f);
+					if (nchannels < 2 && (j & 1))
+						v = 0.0f;
+					break;
+				}
+				frames[i * nchannels + k] = v;
+			}
+		}
+	}
+}
+
+
+// zero-crossing index vs. linear scan.
+static int test_zero_crossing ( uint32_t nframes, uint16_t nchannels, uint32_t seed )
+{
+	char filename[64];
+	::snprintf(filename, sizeof(filename),
+		"drumkv1_test_%u_%u.wav", nchannels, seed);
+
+	float *frames = new float [nframes * nchannels];
+	make_signal(frames, nframes, nchannels, seed);
+	const bool written = write_wav(filename, frames, nframes, nchannels);
+	delete [] frames;
+	if (!written) {
+		::fprintf(stderr, "zero_crossing: could not write %s\n", filename);
+		return 1;
+	}
+
+	drumkv1_test_sample sample;
+	const bool opened = sample.open(filename);
+	::remove(filename);
+	if (!opened || sample.length() != nframes) {
+		::fprintf(stderr, "zero_crossing: could not open %s\n", filename);
+		return 1;
+	}
+
+	int nerrors = 0;
+	for (int reverse = 0; reverse < 2; ++reverse) {
+		sample.setReverse(reverse > 0);
+		for (uint32_t i = 0; i <= nframes; ++i) {
+			for (int s0 = -1; s0 <= +1; ++s0) {
+				int slope1 = s0;
+				int slope2 = s0;
+				const uint32_t i1 = sample.linear_crossing(i, &slope1);
+				const uint32_t i2 = sample.index_crossing(i, &slope2);
+				if (i1 != i2 || slope1 != slope2) {
+					if (++nerrors <= 8) {
+						::fprintf(stderr, "zero_crossing: channels=%u seed=%u"
+							" reverse=%d i=%u slope=%d: linear=%u (%d) index=%u (%d)\n",
+							nchannels, seed, reverse, i, s0, i1, slope1, i2, slope2);
+					}
+				}
+			}
+		}
+	}
+
+	return nerrors;
+}
+
+
+int main ( int, char *[] )
+{
+	// no silence trimming, frames as written.
+	drumkv1_sample::setSilenceThreshold(0.0f);
+
+	int nerrors = 0;
+	for (uint16_t nchannels = 1; nchannels <= 2; ++nchannels) {
+		for (uint32_t seed = 1; seed <= 8; ++seed)
+			nerrors += test_zero_crossing(4096, nchannels, seed);
+		nerrors += test_zero_crossing(2, nchannels, 0);
+	}
+
+	::printf("zero_crossing: %s\n", nerrors ? "FAILED" : "passed");
+
+	return (nerrors ? 1 : 0);
+}
+
+
+// end of drumkv1_test.cpp
@@ -1812,7 +1812,21 @@ void drumkv1widget::updateSchedNotify ( int stype, int sid )
 		} else {
 			updateElement();
 		}
-		// Fall thru...
+		break;
+	case drumkv1_sched::Resample: {
+		drumkv1 *pDrumk = pDrumkUi->instance();
+		const float fProgress
+			= (pDrumk ? pDrumk->resampleProgress() : 1.0f);
+		if (fProgress < 1.0f) {
+			m_ui.StatusBar->showMessage(tr("Resampling... %1%")
+				.arg(int(100.0f * fProgress)));
+		} else {
+			m_ui.StatusBar->showMessage(tr("Resampled"), 5000);
+		}
+		if (sid == pDrumkUi->currentElement())
+			updateElement();
+		break;
+	}
 	default:
 		break;
 	}
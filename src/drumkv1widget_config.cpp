@@ -631,8 +631,10 @@ void drumkv1widget_config::programsEnabled ( bool bOn )
 {
 	if (m_pDrumkUi) {
 		drumkv1_programs *pPrograms = m_pDrumkUi->programs();
-		if (pPrograms && m_pDrumkUi->isPlugin())
+		if (pPrograms && m_pDrumkUi->isPlugin()) {
 			pPrograms->enabled(bOn);
+			pPrograms->preload();
+		}
 	}
 
 	programsChanged();
@@ -1002,6 +1004,7 @@ void drumkv1widget_config::accept (void)
 		if (pPrograms) {
 			m_ui.ProgramsTreeWidget->savePrograms(pPrograms);
 			pConfig->savePrograms(pPrograms);
+			pPrograms->preload();
 			// Reset dirty flag.
 			m_iDirtyPrograms = 0;
 		}
@@ -52,7 +52,7 @@
 
 // Constructor.
 drumkv1widget_sample::drumkv1widget_sample ( QWidget *pParent )
-	: QFrame(pParent), m_pSample(nullptr), m_iChannels(0), m_ppPolyg(nullptr)
+	: QFrame(pParent), m_pSample(nullptr), m_iChannels(0), m_bPixmap(false)
 {
 	QFrame::setMouseTracking(true);
 	QFrame::setFocusPolicy(Qt::ClickFocus);
@@ -86,14 +86,6 @@ drumkv1widget_sample::~drumkv1widget_sample (void)
 // Parameter accessors.
 void drumkv1widget_sample::setSample ( drumkv1_sample *pSample )
 {
-	if (m_pSample && m_ppPolyg) {
-		for (unsigned short k = 0; k < m_iChannels; ++k)
-			delete m_ppPolyg[k];
-		delete [] m_ppPolyg;
-		m_ppPolyg = 0;
-		m_iChannels = 0;
-	}
-
 	m_pSample = pSample;
 
 //	m_bOffset = 0;
@@ -101,47 +93,8 @@ void drumkv1widget_sample::setSample ( drumkv1_sample *pSample )
 
 	m_pDragSample = nullptr;
 
-	if (m_pSample)
-		m_iChannels = m_pSample->channels();
-	if (m_iChannels > 0 && m_ppPolyg == 0) {
-		const int h = height();
-		const int w = width() & 0x7ffe; // force even.
-		const int w2 = (w >> 1);
-		const uint32_t nframes = m_pSample->length();
-		const uint32_t nperiod = nframes / w2;
-		const int h0 = h / m_iChannels;
-		const int h1 = (h0 >> 1);
-		int y0 = h1;
-		m_ppPolyg = new QPolygon* [m_iChannels];
-		for (uint16_t k = 0; k < m_iChannels; ++k) {
-			m_ppPolyg[k] = new QPolygon(w);
-			const float *pframes = m_pSample->frames(k);
-			float vmax = 0.0f;
-			float vmin = 0.0f;
-			int n = 0;
-			int x = 1;
-			uint32_t j = 0;
-			for (uint32_t i = 0; i < nframes; ++i) {
-				const float v = *pframes++;
-				if (vmax < v || j == 0)
-					vmax = v;
-				if (vmin > v || j == 0)
-					vmin = v;
-				if (++j > nperiod) {
-					m_ppPolyg[k]->setPoint(n, x, y0 - int(vmax * h1));
-					m_ppPolyg[k]->setPoint(w - n - 1, x, y0 - int(vmin * h1));
-					vmax = vmin = 0.0f;
-					++n; x += 2; j = 0;
-				}
-			}
-			while (n < w2) {
-				m_ppPolyg[k]->setPoint(n, x, y0);
-				m_ppPolyg[k]->setPoint(w - n - 1, x, y0);
-				++n; x += 2;
-			}
-			y0 += h0;
-		}
-	}
+	m_iChannels = (m_pSample ? m_pSample->channels() : 0);
+	m_bPixmap = false;
 
 	updateToolTip();
 	update();
@@ -246,7 +199,18 @@ uint32_t drumkv1widget_sample::framesFromPixel ( int x ) const
 // Widget resize handler.
 void drumkv1widget_sample::resizeEvent ( QResizeEvent * )
 {
-	setSample(m_pSample);	// reset polygon...
+	m_bPixmap = false;	// reset waveform...
+}
+
+
+// Widget state/palette change handler.
+void drumkv1widget_sample::changeEvent ( QEvent *pEvent )
+{
+	if (pEvent->type() == QEvent::EnabledChange ||
+		pEvent->type() == QEvent::PaletteChange)
+		m_bPixmap = false;
+
+	QFrame::changeEvent(pEvent);
 }
 
 
@@ -485,6 +449,67 @@ void drumkv1widget_sample::resetDragState (void)
 }
 
 
+// Waveform pixmap (re)builder.
+void drumkv1widget_sample::updatePixmap (void)
+{
+	const QRect& rect = QFrame::rect();
+	const int h = rect.height();
+	const int w = rect.width();
+
+	const qreal dpr = devicePixelRatioF();
+	m_pixmap = QPixmap(rect.size() * dpr);
+	m_pixmap.setDevicePixelRatio(dpr);
+	m_bPixmap = true;
+
+	const QPalette& pal = palette();
+	const bool bDark = (pal.window().color().value() < 0x7f);
+	const QColor& rgbLite = (isEnabled() ? Qt::yellow : pal.mid().color());
+	const QColor& rgbDark = pal.window().color().darker();
+
+	QPainter painter(&m_pixmap);
+
+	painter.fillRect(rect, rgbDark);
+
+	if (m_pSample == nullptr || m_iChannels < 1)
+		return;
+
+	QColor rgbLite1(rgbLite);
+	QColor rgbDrop1(Qt::black);
+	rgbLite1.setAlpha(bDark ? 120 : 160);
+	rgbDrop1.setAlpha(80);
+	painter.setRenderHint(QPainter::Antialiasing, true);
+	QLinearGradient grad(0, 0, (w << 1), h);
+	painter.setPen(rgbLite1.darker(160));
+	grad.setColorAt(0.0f, rgbLite1);
+	grad.setColorAt(1.0f, rgbDrop1);
+	painter.setBrush(grad);
+
+	// One column per 2 pixels, min/max from the peak pyramid...
+	const int w1 = (w & 0x7ffe); // force even.
+	const int w2 = (w1 >> 1);
+	const uint32_t nframes = m_pSample->length();
+	const int h0 = h / m_iChannels;
+	const int h1 = (h0 >> 1);
+	int y0 = h1;
+	QPolygon polyg(w1);
+	for (uint16_t k = 0; k < m_iChannels; ++k) {
+		int x = 1;
+		for (int n = 0; n < w2; ++n) {
+			const uint32_t i0 = uint32_t((uint64_t(nframes) * n) / w2);
+			const uint32_t i1 = uint32_t((uint64_t(nframes) * (n + 1)) / w2);
+			float vmin = 0.0f;
+			float vmax = 0.0f;
+			m_pSample->peakRange(k, i0, i1, vmin, vmax);
+			polyg.setPoint(n, x, y0 - int(vmax * h1));
+			polyg.setPoint(w1 - n - 1, x, y0 - int(vmin * h1));
+			x += 2;
+		}
+		painter.drawPolygon(polyg);
+		y0 += h0;
+	}
+}
+
+
 // Draw curve.
 void drumkv1widget_sample::paintEvent ( QPaintEvent *pPaintEvent )
 {
@@ -499,24 +524,16 @@ void drumkv1widget_sample::paintEvent ( QPaintEvent *pPaintEvent )
 	const QColor& rgbLite = (isEnabled() ? Qt::yellow : pal.mid().color());
 	const QColor& rgbDark = pal.window().color().darker();
 
-	painter.fillRect(rect, rgbDark);
-
-	if (m_pSample && m_ppPolyg) {
+	if (m_pSample && m_iChannels > 0) {
 		const bool bEnabled = isEnabled();
 		QColor rgbLite1(rgbLite);
-		QColor rgbDrop1(Qt::black);
 		rgbLite1.setAlpha(bDark ? 120 : 160);
-		rgbDrop1.setAlpha(80);
-		const int w2 = (w << 1);
+		// Sample waveform (cached)...
+		if (!m_bPixmap || m_pixmap.isNull()
+			|| m_pixmap.size() != rect.size() * m_pixmap.devicePixelRatio())
+			updatePixmap();
+		painter.drawPixmap(0, 0, m_pixmap);
 		painter.setRenderHint(QPainter::Antialiasing, true);
-		// Sample waveform...
-		QLinearGradient grad(0, 0, w2, h);
-		painter.setPen(rgbLite1.darker(160));
-		grad.setColorAt(0.0f, rgbLite1);
-		grad.setColorAt(1.0f, rgbDrop1);
-		painter.setBrush(grad);
-		for (unsigned short k = 0; k < m_iChannels; ++k)
-			painter.drawPolygon(*m_ppPolyg[k]);
 		// Offset line...
 		if (m_bOffset && bEnabled) {
 			int x1 = 0, x2 = 0;
@@ -549,6 +566,7 @@ void drumkv1widget_sample::paintEvent ( QPaintEvent *pPaintEvent )
 		}
 		painter.setRenderHint(QPainter::Antialiasing, false);
 	} else {
+		painter.fillRect(rect, rgbDark);
 		painter.setPen(pal.midlight().color());
 		painter.drawText(rect, Qt::AlignCenter,
 			tr("(double-click or drop to load new sample...)"));
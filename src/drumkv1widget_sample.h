@@ -23,6 +23,7 @@
 #define __drumkv1widget_sample_h
 
 #include <QFrame>
+#include <QPixmap>
 
 #include <cstdint>
 
@@ -99,9 +100,15 @@ protected:
 	// Widget resize handler.
 	void resizeEvent(QResizeEvent *);
 
+	// Widget state/palette change handler.
+	void changeEvent(QEvent *pEvent);
+
 	// Draw canvas.
 	void paintEvent(QPaintEvent *);
 
+	// Waveform pixmap (re)builder.
+	void updatePixmap();
+
 	// Mouse interaction.
 	void mousePressEvent(QMouseEvent *pMouseEvent);
 	void mouseMoveEvent(QMouseEvent *pMouseEvent);
@@ -130,7 +137,10 @@ private:
 	// Instance state.
 	drumkv1_sample *m_pSample;
 	unsigned short m_iChannels;
-	QPolygon **m_ppPolyg;
+
+	// Cached waveform (from the sample peak pyramid).
+	QPixmap m_pixmap;
+	bool    m_bPixmap;
 
 	QString m_sName;
 
@@ -23,11 +23,17 @@
 
 #include "drumkv1widget_keybd.h"
 
+#include "drumkv1_sched.h"
+#include "drumkv1_mlock.h"
+
 #include <QLabel>
 #include <QIcon>
 #include <QPixmap>
 #include <QHBoxLayout>
 
+#include <QHelpEvent>
+#include <QToolTip>
+
 #if QT_VERSION < QT_VERSION_CHECK(5, 11, 0)
 #define horizontalAdvance  width
 #endif
@@ -132,4 +138,61 @@ void drumkv1widget_status::modified ( bool bModified )
 }
 
 
+// Scheduler statistics (tooltip).
+bool drumkv1widget_status::event ( QEvent *pEvent )
+{
+	if (pEvent->type() == QEvent::ToolTip) {
+		QHelpEvent *pHelpEvent = static_cast<QHelpEvent *> (pEvent);
+		QToolTip::showText(pHelpEvent->globalPos(), schedStatsText(), this);
+		return true;
+	}
+
+	return QStatusBar::event(pEvent);
+}
+
+
+QString drumkv1widget_status::schedStatsText (void) const
+{
+	static const char *s_names[] = {
+		QT_TR_NOOP("Sample"),
+		QT_TR_NOOP("Programs"),
+		QT_TR_NOOP("Controls"),
+		QT_TR_NOOP("Controller"),
+		QT_TR_NOOP("MIDI In"),
+		QT_TR_NOOP("Resample"),
+		QT_TR_NOOP("Preload"),
+		QT_TR_NOOP("Reclaim")
+	};
+
+	QStringList lines;
+	lines.append(tr("Background tasks:"));
+
+	const int ntypes = int(sizeof(s_names) / sizeof(s_names[0]));
+	for (int k = 0; k < ntypes; ++k) {
+		drumkv1_sched::Stats stats;
+		drumkv1_sched::stats(drumkv1_sched::Type(k), stats);
+		if (stats.scheduled == 0)
+			continue;
+		lines.append(tr("%1: %2 done, %3 merged, %4 dropped;"
+			" max. wait %5 ms, max. run %6 ms")
+			.arg(tr(s_names[k]))
+			.arg(stats.processed)
+			.arg(stats.coalesced)
+			.arg(stats.dropped)
+			.arg(0.001f * float(stats.max_wait), 0, 'f', 1)
+			.arg(0.001f * float(stats.max_run), 0, 'f', 1));
+	}
+
+	if (lines.count() < 2)
+		lines.append(tr("(none)"));
+
+	if (drumkv1_mlock::isEnabled()) {
+		lines.append(tr("Locked memory: %1 MB")
+			.arg(float(drumkv1_mlock::locked()) / (1024.0f * 1024.0f), 0, 'f', 1));
+	}
+
+	return lines.join('\n');
+}
+
+
 // end of drumkv1widget_status.cpp
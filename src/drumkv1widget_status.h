@@ -54,6 +54,13 @@ public:
 	void midiInNote(int iNote, int iVelocity);
 	void modified(bool bModified);
 
+protected:
+
+	// Scheduler statistics (tooltip).
+	bool event(QEvent *pEvent);
+
+	QString schedStatsText() const;
+
 private:
 
 	// Permanent widgets.